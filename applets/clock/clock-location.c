@@ -28,6 +28,8 @@ typedef struct {
   SystemTimezone *systz;
 
   gchar *timezone;
+  /* the parsed rules of timezone */
+  GTimeZone *tz;
 
   gchar *tzname;
 
@@ -54,8 +56,7 @@ enum { WEATHER_UPDATED, SET_CURRENT, LAST_SIGNAL };
 static guint location_signals[LAST_SIGNAL] = {0};
 
 static void clock_location_finalize(GObject *);
-static void clock_location_set_tz(ClockLocation *this);
-static void clock_location_unset_tz(ClockLocation *this);
+static void clock_location_update_tz(ClockLocation *this);
 static gboolean update_weather_info(gpointer data);
 static void setup_weather_updates(ClockLocation *loc);
 
@@ -97,10 +98,7 @@ ClockLocation *clock_location_new(const gchar *name, const gchar *city,
   priv->name = g_strdup(name);
   priv->city = g_strdup(city);
   priv->timezone = g_strdup(timezone);
-
-  /* initialize priv->tzname */
-  clock_location_set_tz(this);
-  clock_location_unset_tz(this);
+  clock_location_update_tz(this);
 
   priv->latitude = latitude;
   priv->longitude = longitude;
@@ -184,6 +182,7 @@ static void clock_location_finalize(GObject *g_obj) {
   g_clear_object(&priv->systz);
 
   g_clear_pointer(&priv->timezone, g_free);
+  g_clear_pointer(&priv->tz, g_time_zone_unref);
   g_clear_pointer(&priv->tzname, g_free);
   g_clear_pointer(&priv->weather_code, g_free);
 
@@ -246,10 +245,32 @@ void clock_location_set_timezone(ClockLocation *loc, const gchar *timezone) {
 
   g_free(priv->timezone);
   priv->timezone = g_strdup(timezone);
+  clock_location_update_tz(loc);
+}
+
+static void clock_location_set_tzname(ClockLocation *this, const char *tzname) {
+  ClockLocationPrivate *priv =
+      clock_location_get_instance_private(CLOCK_LOCATION(this));
+
+  if (priv->tzname && strcmp(priv->tzname, tzname) == 0) return;
+
+  g_free(priv->tzname);
+  if (tzname && *tzname != '\0') {
+    priv->tzname = g_strdup(tzname);
+  } else {
+    priv->tzname = NULL;
+  }
 }
 
+/* Returns the abbreviation of the timezone at the current time */
 gchar *clock_location_get_tzname(ClockLocation *loc) {
   ClockLocationPrivate *priv = clock_location_get_instance_private(loc);
+  gint interval;
+
+  interval =
+      g_time_zone_find_interval(priv->tz, G_TIME_TYPE_UNIVERSAL, time(NULL));
+  clock_location_set_tzname(loc,
+                            g_time_zone_get_abbreviation(priv->tz, interval));
 
   return priv->tzname;
 }
@@ -270,70 +291,41 @@ void clock_location_set_coords(ClockLocation *loc, gfloat latitude,
   priv->longitude = longitude;
 }
 
-static void clock_location_set_tzname(ClockLocation *this, const char *tzname) {
-  ClockLocationPrivate *priv =
-      clock_location_get_instance_private(CLOCK_LOCATION(this));
-
-  if (priv->tzname && strcmp(priv->tzname, tzname) == 0) return;
-
-  g_free(priv->tzname);
-  if (tzname && *tzname != '\0') {
-    priv->tzname = g_strdup(tzname);
-  } else {
-    priv->tzname = NULL;
-  }
-}
-
-static void clock_location_set_tz(ClockLocation *this) {
+/* The zone rules are parsed once here, so that converting a time to the
+ * location's time is a lookup in them instead of a change of the TZ
+ * environment variable for the whole process. */
+static void clock_location_update_tz(ClockLocation *this) {
   ClockLocationPrivate *priv = clock_location_get_instance_private(this);
 
-  time_t now_t;
-  struct tm now;
+  g_clear_pointer(&priv->tz, g_time_zone_unref);
 
-  if (priv->timezone == NULL) {
+  if (!priv->timezone) {
+    priv->tz = g_time_zone_new_local();
     return;
   }
 
-  setenv("TZ", priv->timezone, 1);
-  tzset();
-
-  now_t = time(NULL);
-  localtime_r(&now_t, &now);
-
-  if (now.tm_isdst > 0) {
-    clock_location_set_tzname(this, tzname[1]);
-  } else {
-    clock_location_set_tzname(this, tzname[0]);
-  }
+#if GLIB_CHECK_VERSION(2, 68, 0)
+  priv->tz = g_time_zone_new_identifier(priv->timezone);
+  /* an unknown TZ value means UTC for the C library too */
+  if (!priv->tz) priv->tz = g_time_zone_new_utc();
+#else
+  priv->tz = g_time_zone_new(priv->timezone);
+#endif
 }
 
-static void clock_location_unset_tz(ClockLocation *this) {
-  ClockLocationPrivate *priv = clock_location_get_instance_private(this);
-  const char *env_timezone;
-
-  if (priv->timezone == NULL) {
-    return;
-  }
+void clock_location_time_to_tm(ClockLocation *loc, time_t t, struct tm *tm) {
+  ClockLocationPrivate *priv = clock_location_get_instance_private(loc);
+  gint interval;
 
-  env_timezone = system_timezone_get_env(priv->systz);
+  interval = g_time_zone_find_interval(priv->tz, G_TIME_TYPE_UNIVERSAL, t);
 
-  if (env_timezone) {
-    setenv("TZ", env_timezone, 1);
-  } else {
-    unsetenv("TZ");
-  }
-  tzset();
+  t += g_time_zone_get_offset(priv->tz, interval);
+  gmtime_r(&t, tm);
+  tm->tm_isdst = g_time_zone_is_dst(priv->tz, interval) ? 1 : 0;
 }
 
 void clock_location_localtime(ClockLocation *loc, struct tm *tm) {
-  time_t now;
-
-  clock_location_set_tz(loc);
-
-  time(&now);
-  localtime_r(&now, tm);
-
-  clock_location_unset_tz(loc);
+  clock_location_time_to_tm(loc, time(NULL), tm);
 }
 
 gboolean clock_location_is_current_timezone(ClockLocation *loc) {
@@ -369,34 +361,24 @@ gboolean clock_location_is_current(ClockLocation *loc) {
   return FALSE;
 }
 
+/* Returns how many seconds the location is behind the system timezone */
 glong clock_location_get_offset(ClockLocation *loc) {
   ClockLocationPrivate *priv = clock_location_get_instance_private(loc);
-  glong sys_timezone, local_timezone;
+  GTimeZone *local_tz;
+  gint64 t;
   glong offset;
-  time_t t;
-  struct tm *tm;
 
   t = time(NULL);
+  local_tz = g_time_zone_new_local();
 
-  unsetenv("TZ");
-  tm = localtime(&t);
-  sys_timezone = timezone;
-
-  if (tm->tm_isdst > 0) {
-    sys_timezone -= 3600;
-  }
-
-  setenv("TZ", priv->timezone, 1);
-  tm = localtime(&t);
-  local_timezone = timezone;
-
-  if (tm->tm_isdst > 0) {
-    local_timezone -= 3600;
-  }
-
-  offset = local_timezone - sys_timezone;
+  offset = g_time_zone_get_offset(
+               local_tz,
+               g_time_zone_find_interval(local_tz, G_TIME_TYPE_UNIVERSAL, t)) -
+           g_time_zone_get_offset(
+               priv->tz,
+               g_time_zone_find_interval(priv->tz, G_TIME_TYPE_UNIVERSAL, t));
 
-  clock_location_unset_tz(loc);
+  g_time_zone_unref(local_tz);
 
   return offset;
 }
@@ -64,6 +64,7 @@ void clock_location_set_coords(ClockLocation *loc, gfloat latitude,
                                gfloat longitude);
 
 void clock_location_localtime(ClockLocation *loc, struct tm *tm);
+void clock_location_time_to_tm(ClockLocation *loc, time_t t, struct tm *tm);
 
 gboolean clock_location_is_current(ClockLocation *loc);
 void clock_location_make_current(ClockLocation *loc, GFunc callback,
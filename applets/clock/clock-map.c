@@ -40,6 +40,17 @@ typedef struct {
 
   /* The map with the shadow composited onto it */
   GdkPixbuf *shadow_map_pixbuf;
+
+  /* Trigonometry of the longitude of each column and of the latitude of
+   * each row, for the current size */
+  gint tables_width;
+  gint tables_height;
+  gfloat *sin_lon;
+  gfloat *cos_lon;
+  gfloat *sin_lat;
+  gfloat *cos_lat;
+  /* Longitude dependent part of the dot product with the sun vector */
+  gfloat *lon_dot;
 } ClockMapPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(ClockMap, clock_map, GTK_TYPE_WIDGET)
@@ -137,6 +148,12 @@ static void clock_map_finalize(GObject *g_obj) {
   g_clear_object(&priv->shadow_pixbuf);
   g_clear_object(&priv->shadow_map_pixbuf);
 
+  g_free(priv->sin_lon);
+  g_free(priv->cos_lon);
+  g_free(priv->sin_lat);
+  g_free(priv->cos_lat);
+  g_free(priv->lon_dot);
+
   G_OBJECT_CLASS(clock_map_parent_class)->finalize(g_obj);
 }
 
@@ -158,6 +175,11 @@ void clock_map_refresh(ClockMap *this) {
       priv->stock_map_pixbuf = NULL;
     }
 
+    /* the other buffers are reused as long as the size does not change */
+    g_clear_object(&priv->location_map_pixbuf);
+    g_clear_object(&priv->shadow_pixbuf);
+    g_clear_object(&priv->shadow_map_pixbuf);
+
     priv->width = allocation.width;
     priv->height = allocation.height;
   }
@@ -356,12 +378,11 @@ static void clock_map_place_locations(ClockMap *this) {
   ClockMapPrivate *priv = clock_map_get_instance_private(this);
   GSList *locs;
 
-  if (priv->location_map_pixbuf) {
-    g_object_unref(priv->location_map_pixbuf);
-    priv->location_map_pixbuf = NULL;
-  }
-
-  priv->location_map_pixbuf = gdk_pixbuf_copy(priv->stock_map_pixbuf);
+  if (priv->location_map_pixbuf)
+    gdk_pixbuf_copy_area(priv->stock_map_pixbuf, 0, 0, priv->width,
+                         priv->height, priv->location_map_pixbuf, 0, 0);
+  else
+    priv->location_map_pixbuf = gdk_pixbuf_copy(priv->stock_map_pixbuf);
 
   locs = NULL;
   g_signal_emit(this, signals[NEED_LOCATIONS], 0, &locs);
@@ -383,41 +404,54 @@ static void clock_map_compute_vector(gdouble lat, gdouble lon, gdouble *vec) {
   vec[2] = cos(lon_rad) * cos(lat_rad);
 }
 
-static guchar clock_map_is_sunlit(gdouble pos_lat, gdouble pos_long,
-                                  gdouble sun_lat, gdouble sun_long) {
-  gdouble pos_vec[3];
-  gdouble sun_vec[3];
-  gdouble dot;
+static void clock_map_ensure_tables(ClockMap *this) {
+  ClockMapPrivate *priv = clock_map_get_instance_private(this);
+  int x, y;
 
-  /* twilight */
-  gdouble epsilon = 0.01;
+  if (priv->tables_width == priv->width && priv->tables_height == priv->height)
+    return;
 
-  clock_map_compute_vector(pos_lat, pos_long, pos_vec);
-  clock_map_compute_vector(sun_lat, sun_long, sun_vec);
+  priv->tables_width = priv->width;
+  priv->tables_height = priv->height;
 
-  /* compute the dot product of the two */
-  dot = pos_vec[0] * sun_vec[0] + pos_vec[1] * sun_vec[1] +
-        pos_vec[2] * sun_vec[2];
+  priv->sin_lon = g_renew(gfloat, priv->sin_lon, priv->width);
+  priv->cos_lon = g_renew(gfloat, priv->cos_lon, priv->width);
+  priv->lon_dot = g_renew(gfloat, priv->lon_dot, priv->width);
+  priv->sin_lat = g_renew(gfloat, priv->sin_lat, priv->height);
+  priv->cos_lat = g_renew(gfloat, priv->cos_lat, priv->height);
 
-  if (dot > epsilon) {
-    return 0x00;
-  }
+  for (x = 0; x < priv->width; x++) {
+    gdouble lon = (x - priv->width / 2.0) / (priv->width / 2.0) * 180.0;
 
-  if (dot < -epsilon) {
-    return 0xFF;
+    priv->sin_lon[x] = sin(lon * (M_PI / 180.0));
+    priv->cos_lon[x] = cos(lon * (M_PI / 180.0));
   }
 
-  return (guchar)(-128 * ((dot / epsilon) - 1));
+  for (y = 0; y < priv->height; y++) {
+    gdouble lat = (priv->height / 2.0 - y) / (priv->height / 2.0) * 90.0;
+
+    priv->sin_lat[y] = sin(lat * (M_PI / 180.0));
+    priv->cos_lat[y] = cos(lat * (M_PI / 180.0));
+  }
 }
 
-static void clock_map_render_shadow_pixbuf(GdkPixbuf *pixbuf) {
+/* Sets the alpha of each pixel to how much it is in the night. The dot
+ * product of the position and sun vectors factors into
+ *   cos (lat) * (sin (lon) * sun[0] + cos (lon) * sun[2]) + sin (lat) * sun[1]
+ * so with the tables, each row is a multiply-add over the lon_dot array. */
+static void clock_map_render_shadow_pixbuf(ClockMap *this, GdkPixbuf *pixbuf) {
+  ClockMapPrivate *priv = clock_map_get_instance_private(this);
   int x, y;
   int height, width;
   int n_channels, rowstride;
-  guchar *pixels, *p;
+  guchar *pixels;
   gdouble sun_lat, sun_lon;
+  gdouble sun_vec[3];
   time_t now = time(NULL);
 
+  /* twilight */
+  const gfloat epsilon = 0.01;
+
   n_channels = gdk_pixbuf_get_n_channels(pixbuf);
   rowstride = gdk_pixbuf_get_rowstride(pixbuf);
   pixels = gdk_pixbuf_get_pixels(pixbuf);
@@ -425,19 +459,31 @@ static void clock_map_render_shadow_pixbuf(GdkPixbuf *pixbuf) {
   width = gdk_pixbuf_get_width(pixbuf);
   height = gdk_pixbuf_get_height(pixbuf);
 
+  g_return_if_fail(width == priv->tables_width);
+  g_return_if_fail(height == priv->tables_height);
+
   sun_position(now, &sun_lat, &sun_lon);
+  clock_map_compute_vector(sun_lat, sun_lon, sun_vec);
+
+  for (x = 0; x < width; x++)
+    priv->lon_dot[x] =
+        priv->sin_lon[x] * sun_vec[0] + priv->cos_lon[x] * sun_vec[2];
 
   for (y = 0; y < height; y++) {
-    gdouble lat = (height / 2.0 - y) / (height / 2.0) * 90.0;
+    const gfloat *lon_dot = priv->lon_dot;
+    gfloat cos_lat = priv->cos_lat[y];
+    gfloat lat_dot = priv->sin_lat[y] * sun_vec[1];
+    guchar *p = pixels + y * rowstride + 3;
 
     for (x = 0; x < width; x++) {
-      guchar shade;
-      gdouble lon = (x - width / 2.0) / (width / 2.0) * 180.0;
+      gfloat dot = cos_lat * lon_dot[x] + lat_dot;
+      gfloat shade = 128.0f * (1.0f - dot / epsilon);
 
-      shade = clock_map_is_sunlit(lat, lon, sun_lat, sun_lon);
+      /* 0x00 in the day, 0xFF in the night, a ramp in between */
+      shade = shade < 0.0f ? 0.0f : shade;
+      shade = shade > 255.0f ? 255.0f : shade;
 
-      p = pixels + y * rowstride + x * n_channels;
-      p[3] = shade;
+      p[x * n_channels] = (guchar)shade;
     }
   }
 }
@@ -445,23 +491,23 @@ static void clock_map_render_shadow_pixbuf(GdkPixbuf *pixbuf) {
 static void clock_map_render_shadow(ClockMap *this) {
   ClockMapPrivate *priv = clock_map_get_instance_private(this);
 
-  if (priv->shadow_pixbuf) {
-    g_object_unref(priv->shadow_pixbuf);
-  }
-
-  priv->shadow_pixbuf =
-      gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, priv->width, priv->height);
+  clock_map_ensure_tables(this);
 
-  /* Initialize to all shadow */
-  gdk_pixbuf_fill(priv->shadow_pixbuf, 0x6d9ccdff);
+  if (!priv->shadow_pixbuf) {
+    priv->shadow_pixbuf =
+        gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, priv->width, priv->height);
 
-  clock_map_render_shadow_pixbuf(priv->shadow_pixbuf);
-
-  if (priv->shadow_map_pixbuf) {
-    g_object_unref(priv->shadow_map_pixbuf);
+    /* Initialize to all shadow, only the alpha changes afterwards */
+    gdk_pixbuf_fill(priv->shadow_pixbuf, 0x6d9ccdff);
   }
 
-  priv->shadow_map_pixbuf = gdk_pixbuf_copy(priv->location_map_pixbuf);
+  clock_map_render_shadow_pixbuf(this, priv->shadow_pixbuf);
+
+  if (priv->shadow_map_pixbuf)
+    gdk_pixbuf_copy_area(priv->location_map_pixbuf, 0, 0, priv->width,
+                         priv->height, priv->shadow_map_pixbuf, 0, 0);
+  else
+    priv->shadow_map_pixbuf = gdk_pixbuf_copy(priv->location_map_pixbuf);
 
   gdk_pixbuf_composite(priv->shadow_pixbuf, priv->shadow_map_pixbuf, 0, 0,
                        priv->width, priv->height, 0, 0, 1, 1,
@@ -50,6 +50,16 @@
 #include <time.h>
 #include <unistd.h>
 
+#ifdef HAVE_SYS_TIMERFD_H
+#include <errno.h>
+#include <glib-unix.h>
+#include <sys/timerfd.h>
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+#endif
+
 #ifdef HAVE_X11
 #include <gdk/gdkx.h>
 #endif
@@ -157,7 +167,12 @@ struct _ClockData {
   /* runtime data */
   time_t current_time;
   char *timeformat;
+  char *clock_text;
   guint timeout;
+#ifdef HAVE_SYS_TIMERFD_H
+  int timer_fd;
+  guint timer_fd_source;
+#endif
   MatePanelAppletOrient orient;
   int size;
   GtkAllocation old_allocation;
@@ -229,6 +244,8 @@ static void clock_box_class_init(ClockBoxClass *klass) {}
 static void unfix_size(ClockData *cd) {
   cd->fixed_width = -1;
   cd->fixed_height = -1;
+  /* force the next update_clock () to set the label again */
+  g_clear_pointer(&cd->clock_text, g_free);
   gtk_widget_queue_resize(cd->panel_button);
 }
 
@@ -257,41 +274,94 @@ static int calculate_minimum_width(GtkWidget *widget, const gchar *text) {
   return width;
 }
 
-static void clock_set_timeout(ClockData *cd, time_t now) {
-  int timeouttime;
+/* Returns the wall clock time, in microseconds, at which the displayed time
+ * next changes. */
+static gint64 clock_get_next_tick(ClockData *cd, gint64 now) {
+  gint64 period;
+
+  if (cd->format == CLOCK_FORMAT_INTERNET && !cd->showseconds) {
+    /* a beat lasts 86.4 seconds from midnight BMT, but get_itime () only
+     * sees whole seconds: wake up on the first one of the next beat */
+    gint64 offset = G_GINT64_CONSTANT(3600) * G_USEC_PER_SEC;
+    gint64 beat = INTERNETBEAT * (G_USEC_PER_SEC / 1000);
+    gint64 next = ((now + offset) / beat + 1) * beat - offset;
 
-  if (cd->format == CLOCK_FORMAT_INTERNET) {
-    int itime_ms;
+    return (next + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC * G_USEC_PER_SEC;
+  }
 
-    itime_ms = ((unsigned int)(get_itime(now) * 1000));
+  period = G_USEC_PER_SEC;
 
-    if (!cd->showseconds)
-      timeouttime = (999 - itime_ms % 1000) * 86.4 + 1;
-    else {
-      struct timeval tv;
-      gettimeofday(&tv, NULL);
-      itime_ms += (tv.tv_usec * 86.4) / 1000;
-      timeouttime = ((999 - itime_ms % 1000) * 86.4) / 100 + 1;
-    }
-  } else {
-    struct timeval tv;
+  /* wake up once a minute if we don't care about the seconds */
+  if (cd->format != CLOCK_FORMAT_UNIX &&
+      cd->format != CLOCK_FORMAT_INTERNET && !cd->showseconds &&
+      (!cd->set_time_window || !gtk_widget_get_visible(cd->set_time_window)))
+    period *= 60;
+
+  return (now / period + 1) * period;
+}
+
+#ifdef HAVE_SYS_TIMERFD_H
+static gboolean clock_timer_fd_callback(gint fd, GIOCondition condition,
+                                        gpointer data) {
+  guint64 expirations;
 
-    gettimeofday(&tv, NULL);
-    timeouttime = (G_USEC_PER_SEC - tv.tv_usec) / 1000 + 20;
+  /* ECANCELED means the wall clock was set: the timer gets armed again
+   * for the new time below, just as if it had expired */
+  if (read(fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN)
+    return G_SOURCE_CONTINUE;
 
-    /* timeout of one minute if we don't care about the seconds */
-    if (cd->format != CLOCK_FORMAT_UNIX && !cd->showseconds &&
-        (!cd->set_time_window || !gtk_widget_get_visible(cd->set_time_window)))
-      timeouttime += 1000 * (59 - now % 60);
+  clock_timeout_callback(data);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Arms a timer on the wall clock rather than on the monotonic one, so that
+ * the tick lands on the boundary even after a suspend or a time change,
+ * and the panel only wakes up when there is something to draw. */
+static gboolean clock_set_timer_fd(ClockData *cd, gint64 next) {
+  struct itimerspec spec = {{0, 0}, {0, 0}};
+
+  if (!cd->timer_fd_source) {
+    cd->timer_fd =
+        timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (cd->timer_fd < 0) return FALSE;
+
+    cd->timer_fd_source =
+        g_unix_fd_add(cd->timer_fd, G_IO_IN, clock_timer_fd_callback, cd);
   }
 
-  cd->timeout = g_timeout_add(timeouttime, clock_timeout_callback, cd);
+  spec.it_value.tv_sec = next / G_USEC_PER_SEC;
+  spec.it_value.tv_nsec = (next % G_USEC_PER_SEC) * 1000;
+
+  return timerfd_settime(cd->timer_fd,
+                         TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec,
+                         NULL) == 0;
+}
+#endif
+
+static void clock_set_timeout(ClockData *cd) {
+  gint64 now;
+  gint64 next;
+
+  now = g_get_real_time();
+  next = clock_get_next_tick(cd, now);
+
+#ifdef HAVE_SYS_TIMERFD_H
+  if (clock_set_timer_fd(cd, next)) return;
+#endif
+
+  /* rather a bit late than early */
+  cd->timeout = g_timeout_add((next - now) / 1000 + 20,
+                              clock_timeout_callback, cd);
 }
 
 static int clock_timeout_callback(gpointer data) {
   ClockData *cd = data;
   time_t new_time;
 
+  /* the source is removed by returning FALSE */
+  cd->timeout = 0;
+
   time(&new_time);
 
   if (!cd->showseconds &&
@@ -309,7 +379,7 @@ static int clock_timeout_callback(gpointer data) {
     update_clock(cd);
   }
 
-  clock_set_timeout(cd, new_time);
+  clock_set_timeout(cd);
 
   return FALSE;
 }
@@ -534,30 +604,51 @@ static gchar *format_time_24(ClockData *cd) {
 static void update_clock(ClockData *cd) {
   gboolean use_markup;
   char *utf8, *text;
+  int old_width, old_height;
+  int width, height;
 
   time(&cd->current_time);
   utf8 = format_time(cd);
 
-  use_markup = FALSE;
-  if (pango_parse_markup(utf8, -1, 0, NULL, &text, NULL, NULL))
-    use_markup = TRUE;
-  else
-    text = g_strdup(utf8);
+  /* Most ticks do not change what is displayed (a custom format without
+   * seconds, the beats...): skip the label update and the relayout it
+   * triggers in the panel in that case. */
+  if (g_strcmp0(utf8, cd->clock_text) == 0) {
+    g_free(utf8);
+  } else {
+    use_markup = FALSE;
+    if (pango_parse_markup(utf8, -1, 0, NULL, &text, NULL, NULL))
+      use_markup = TRUE;
+    else
+      text = g_strdup(utf8);
 
-  if (use_markup)
-    gtk_label_set_markup(GTK_LABEL(cd->clockw), utf8);
-  else
-    gtk_label_set_text(GTK_LABEL(cd->clockw), utf8);
+    pango_layout_get_pixel_size(gtk_label_get_layout(GTK_LABEL(cd->clockw)),
+                                &old_width, &old_height);
 
-  set_atk_name_description(cd->applet, text, NULL);
+    if (use_markup)
+      gtk_label_set_markup(GTK_LABEL(cd->clockw), utf8);
+    else
+      gtk_label_set_text(GTK_LABEL(cd->clockw), utf8);
 
-  g_free(utf8);
-  g_free(text);
+    set_atk_name_description(cd->applet, text, NULL);
 
-  update_orient(cd);
-  gtk_widget_queue_resize(cd->panel_button);
+    g_free(cd->clock_text);
+    cd->clock_text = utf8;
+    g_free(text);
+
+    update_orient(cd);
+
+    /* digits usually all have the same width: the text changing every
+     * second or minute rarely changes the extent of the label, and only
+     * then does the panel need a relayout */
+    pango_layout_get_pixel_size(gtk_label_get_layout(GTK_LABEL(cd->clockw)),
+                                &width, &height);
+    if (width != old_width || height != old_height)
+      gtk_widget_queue_resize(cd->panel_button);
+
+    update_tooltip(cd);
+  }
 
-  update_tooltip(cd);
   update_location_tiles(cd);
 
   if (cd->map_widget && cd->calendar_popup &&
@@ -643,10 +734,11 @@ static void refresh_clock_timeout(ClockData *cd) {
   update_timeformat(cd);
 
   if (cd->timeout) g_source_remove(cd->timeout);
+  cd->timeout = 0;
 
   update_clock(cd);
 
-  clock_set_timeout(cd, cd->current_time);
+  clock_set_timeout(cd);
 }
 
 /**
@@ -655,6 +747,7 @@ static void refresh_clock_timeout(ClockData *cd) {
  */
 static void refresh_click_timeout_time_only(ClockData *cd) {
   if (cd->timeout) g_source_remove(cd->timeout);
+  cd->timeout = 0;
   clock_timeout_callback(cd);
 }
 
@@ -680,6 +773,14 @@ static void destroy_clock(GtkWidget *widget, ClockData *cd) {
   if (cd->timeout) g_source_remove(cd->timeout);
   cd->timeout = 0;
 
+#ifdef HAVE_SYS_TIMERFD_H
+  if (cd->timer_fd_source) {
+    g_source_remove(cd->timer_fd_source);
+    close(cd->timer_fd);
+  }
+  cd->timer_fd_source = 0;
+#endif
+
   if (cd->props) gtk_widget_destroy(cd->props);
   cd->props = NULL;
 
@@ -687,6 +788,7 @@ static void destroy_clock(GtkWidget *widget, ClockData *cd) {
   cd->calendar_popup = NULL;
 
   g_free(cd->timeformat);
+  g_free(cd->clock_text);
 
   g_free(cd->custom_format);
 
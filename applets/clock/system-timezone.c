@@ -47,6 +47,7 @@
 
 #include "system-timezone.h"
 
+#include <errno.h>
 #include <gio/gio.h>
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -553,96 +554,235 @@ static char *system_timezone_read_etc_localtime_softlink(void) {
   return tz;
 }
 
-typedef gboolean (*CompareFiles)(struct stat *a_stat, struct stat *b_stat,
-                                 const char *a_content, gsize a_content_len,
-                                 const char *b_filename);
+/* Finding which zone file /etc/localtime is a hard link to, or a copy of,
+ * needs to look at every file under SYSTEM_ZONEINFODIR. Instead of doing
+ * that on each lookup, the zone files are indexed by inode and by content
+ * once, and the index is cached in the user cache directory. It is valid
+ * as long as none of the zoneinfo directories changed. */
+#define ZONEINFO_INDEX_FILE "zoneinfo-index"
+#define ZONEINFO_INDEX_VERSION 1
+#define ZONEINFO_INDEX_TYPE "(usa(sx)a(sts))"
+
+static GVariant *zoneinfo_index = NULL;
+static GHashTable *zoneinfo_by_inode = NULL;
+static GHashTable *zoneinfo_by_content = NULL;
+static GArray *zoneinfo_inodes = NULL;
+
+static char *zoneinfo_index_get_file(void) {
+  return g_build_filename(g_get_user_cache_dir(), "mate-panel",
+                          ZONEINFO_INDEX_FILE, NULL);
+}
+
+/* The content of a zone file is identified by its size and its checksum */
+static char *zoneinfo_index_get_content_key(const char *content, gsize len) {
+  char *checksum;
+  char *key;
 
-static char *recursive_compare(struct stat *localtime_stat,
-                               const char *localtime_content,
-                               gsize localtime_content_len, char *file,
-                               CompareFiles compare_func) {
-  struct stat file_stat;
+  checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                                         (const guchar *)content, len);
+  key = g_strdup_printf("%" G_GSIZE_FORMAT ":%s", len, checksum);
+  g_free(checksum);
+
+  return key;
+}
 
-  if (g_stat(file, &file_stat) != 0) return NULL;
+static void zoneinfo_index_walk(const char *path, GVariantBuilder *dirs,
+                                GVariantBuilder *files) {
+  GStatBuf file_stat;
+
+  if (g_stat(path, &file_stat) != 0) return;
 
   if (S_ISREG(file_stat.st_mode)) {
-    if (compare_func(localtime_stat, &file_stat, localtime_content,
-                     localtime_content_len, file))
-      return system_timezone_strip_path_if_valid(file);
-    else
-      return NULL;
+    char *content;
+    gsize len;
+    char *name;
+    char *key;
+
+    if (!g_file_get_contents(path, &content, &len, NULL)) return;
+
+    if (len >= strlen(TZ_MAGIC) &&
+        strncmp(content, TZ_MAGIC, strlen(TZ_MAGIC)) == 0) {
+      name = system_timezone_strip_path_if_valid(path);
+      key = zoneinfo_index_get_content_key(content, len);
+      g_variant_builder_add(files, "(sts)", name, (guint64)file_stat.st_ino,
+                            key);
+      g_free(key);
+      g_free(name);
+    }
+
+    g_free(content);
   } else if (S_ISDIR(file_stat.st_mode)) {
-    GDir *dir = NULL;
-    char *ret = NULL;
-    const char *subfile = NULL;
-    char *subpath = NULL;
+    GDir *dir;
+    const char *subfile;
 
-    dir = g_dir_open(file, 0, NULL);
-    if (dir == NULL) return NULL;
+    dir = g_dir_open(path, 0, NULL);
+    if (dir == NULL) return;
 
-    while ((subfile = g_dir_read_name(dir)) != NULL) {
-      subpath = g_build_filename(file, subfile, NULL);
+    g_variant_builder_add(dirs, "(sx)", path, (gint64)file_stat.st_mtime);
 
-      ret = recursive_compare(localtime_stat, localtime_content,
-                              localtime_content_len, subpath, compare_func);
+    while ((subfile = g_dir_read_name(dir)) != NULL) {
+      char *subpath = g_build_filename(path, subfile, NULL);
 
+      zoneinfo_index_walk(subpath, dirs, files);
       g_free(subpath);
-
-      if (ret != NULL) break;
     }
 
     g_dir_close(dir);
+  }
+}
 
-    return ret;
+static GVariant *zoneinfo_index_build(void) {
+  GVariantBuilder dirs;
+  GVariantBuilder files;
+  GVariant *index;
+  char *filename;
+  char *dirname;
+  GError *error = NULL;
+
+  g_variant_builder_init(&dirs, G_VARIANT_TYPE("a(sx)"));
+  g_variant_builder_init(&files, G_VARIANT_TYPE("a(sts)"));
+
+  zoneinfo_index_walk(SYSTEM_ZONEINFODIR, &dirs, &files);
+
+  index = g_variant_ref_sink(g_variant_new("(usa(sx)a(sts))",
+                                           ZONEINFO_INDEX_VERSION,
+                                           SYSTEM_ZONEINFODIR, &dirs, &files));
+
+  filename = zoneinfo_index_get_file();
+  dirname = g_path_get_dirname(filename);
+
+  if (g_mkdir_with_parents(dirname, 0700) != 0 ||
+      !g_file_set_contents(filename, g_variant_get_data(index),
+                           g_variant_get_size(index), &error)) {
+    g_warning("Cannot save the zoneinfo index to '%s': %s", filename,
+              error ? error->message : g_strerror(errno));
+    g_clear_error(&error);
   }
 
-  return NULL;
+  g_free(dirname);
+  g_free(filename);
+
+  return index;
+}
+
+static gboolean zoneinfo_index_is_current(GVariant *index) {
+  GVariant *dirs;
+  GVariantIter iter;
+  const char *dir;
+  const char *zoneinfo_dir;
+  gint64 mtime;
+  guint32 version;
+  gboolean current;
+
+  g_variant_get_child(index, 0, "u", &version);
+  g_variant_get_child(index, 1, "&s", &zoneinfo_dir);
+
+  if (version != ZONEINFO_INDEX_VERSION ||
+      g_strcmp0(zoneinfo_dir, SYSTEM_ZONEINFODIR) != 0)
+    return FALSE;
+
+  dirs = g_variant_get_child_value(index, 2);
+  current = g_variant_n_children(dirs) > 0;
+
+  g_variant_iter_init(&iter, dirs);
+  while (current && g_variant_iter_next(&iter, "(&sx)", &dir, &mtime)) {
+    GStatBuf dir_stat;
+
+    current = g_stat(dir, &dir_stat) == 0 && dir_stat.st_mtime == mtime;
+  }
+
+  g_variant_unref(dirs);
+
+  return current;
+}
+
+static GVariant *zoneinfo_index_load(void) {
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *index;
+  char *filename;
+
+  filename = zoneinfo_index_get_file();
+  mapped = g_mapped_file_new(filename, FALSE, NULL);
+  g_free(filename);
+
+  if (!mapped) return NULL;
+
+  bytes = g_mapped_file_get_bytes(mapped);
+  g_mapped_file_unref(mapped);
+
+  index = g_variant_ref_sink(g_variant_new_from_bytes(
+      G_VARIANT_TYPE(ZONEINFO_INDEX_TYPE), bytes, FALSE));
+  g_bytes_unref(bytes);
+
+  if (!zoneinfo_index_is_current(index)) {
+    g_variant_unref(index);
+    return NULL;
+  }
+
+  return index;
 }
 
-static gboolean files_are_identical_inode(struct stat *a_stat,
-                                          struct stat *b_stat,
-                                          const char *a_content,
-                                          gsize a_content_len,
-                                          const char *b_filename) {
-  return (a_stat->st_ino == b_stat->st_ino);
+/* Makes sure the lookup tables are built from a current index. The names
+ * and keys in the tables point into the index. */
+static void zoneinfo_index_ensure(void) {
+  GVariant *files;
+  GVariantIter iter;
+  const char *name;
+  const char *key;
+  guint64 inode;
+  gsize i;
+
+  if (zoneinfo_index && zoneinfo_index_is_current(zoneinfo_index)) return;
+
+  g_clear_pointer(&zoneinfo_by_inode, g_hash_table_destroy);
+  g_clear_pointer(&zoneinfo_by_content, g_hash_table_destroy);
+  g_clear_pointer(&zoneinfo_inodes, g_array_unref);
+  g_clear_pointer(&zoneinfo_index, g_variant_unref);
+
+  zoneinfo_index = zoneinfo_index_load();
+  if (!zoneinfo_index) zoneinfo_index = zoneinfo_index_build();
+
+  files = g_variant_get_child_value(zoneinfo_index, 3);
+
+  zoneinfo_by_inode = g_hash_table_new(g_int64_hash, g_int64_equal);
+  zoneinfo_by_content = g_hash_table_new(g_str_hash, g_str_equal);
+  /* sized once, so that the keys of zoneinfo_by_inode never move */
+  zoneinfo_inodes = g_array_sized_new(FALSE, FALSE, sizeof(gint64),
+                                      g_variant_n_children(files));
+  g_array_set_size(zoneinfo_inodes, g_variant_n_children(files));
+
+  /* keep the first name found for a file, as the tree walk did */
+  i = 0;
+  g_variant_iter_init(&iter, files);
+  while (g_variant_iter_next(&iter, "(&st&s)", &name, &inode, &key)) {
+    gint64 *inode_key = &g_array_index(zoneinfo_inodes, gint64, i++);
+
+    *inode_key = (gint64)inode;
+    if (!g_hash_table_contains(zoneinfo_by_inode, inode_key))
+      g_hash_table_insert(zoneinfo_by_inode, inode_key, (gpointer)name);
+    if (!g_hash_table_contains(zoneinfo_by_content, key))
+      g_hash_table_insert(zoneinfo_by_content, (gpointer)key, (gpointer)name);
+  }
+
+  g_variant_unref(files);
 }
 
 /* Determine if /etc/localtime is a hard link to some file, by looking at
  * the inodes */
 static char *system_timezone_read_etc_localtime_hardlink(void) {
   struct stat stat_localtime;
+  gint64 inode;
 
   if (g_stat(ETC_LOCALTIME, &stat_localtime) != 0) return NULL;
 
   if (!S_ISREG(stat_localtime.st_mode)) return NULL;
 
-  return recursive_compare(&stat_localtime, NULL, 0, SYSTEM_ZONEINFODIR,
-                           files_are_identical_inode);
-}
-
-static gboolean files_are_identical_content(struct stat *a_stat,
-                                            struct stat *b_stat,
-                                            const char *a_content,
-                                            gsize a_content_len,
-                                            const char *b_filename) {
-  char *b_content = NULL;
-  gsize b_content_len = -1;
-  int cmp;
+  zoneinfo_index_ensure();
 
-  if (a_stat->st_size != b_stat->st_size) return FALSE;
+  inode = (gint64)stat_localtime.st_ino;
 
-  if (!g_file_get_contents(b_filename, &b_content, &b_content_len, NULL))
-    return FALSE;
-
-  if (a_content_len != b_content_len) {
-    g_free(b_content);
-    return FALSE;
-  }
-
-  cmp = memcmp(a_content, b_content, a_content_len);
-  g_free(b_content);
-
-  return (cmp == 0);
+  return g_strdup(g_hash_table_lookup(zoneinfo_by_inode, &inode));
 }
 
 /* Determine if /etc/localtime is a copy of a timezone file */
@@ -650,20 +790,24 @@ static char *system_timezone_read_etc_localtime_content(void) {
   struct stat stat_localtime;
   char *localtime_content = NULL;
   gsize localtime_content_len = -1;
+  char *key;
   char *retval;
 
   if (g_stat(ETC_LOCALTIME, &stat_localtime) != 0) return NULL;
 
   if (!S_ISREG(stat_localtime.st_mode)) return NULL;
 
+  zoneinfo_index_ensure();
+
   if (!g_file_get_contents(ETC_LOCALTIME, &localtime_content,
                            &localtime_content_len, NULL))
     return NULL;
 
-  retval = recursive_compare(&stat_localtime, localtime_content,
-                             localtime_content_len, SYSTEM_ZONEINFODIR,
-                             files_are_identical_content);
+  key = zoneinfo_index_get_content_key(localtime_content,
+                                       localtime_content_len);
+  retval = g_strdup(g_hash_table_lookup(zoneinfo_by_content, key));
 
+  g_free(key);
   g_free(localtime_content);
 
   return retval;
@@ -681,8 +825,7 @@ static GetSystemTimezone get_system_timezone_methods[] = {
     system_timezone_read_etc_TIMEZONE, system_timezone_read_etc_rc_conf,
     /* reading deprecated config files */
     system_timezone_read_etc_conf_d_clock,
-    /* reading /etc/timezone directly. Expensive since we have to stat
-     * many files */
+    /* reading /etc/localtime directly, through the zoneinfo index */
     system_timezone_read_etc_localtime_hardlink,
     system_timezone_read_etc_localtime_content, NULL};
 
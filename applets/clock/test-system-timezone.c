@@ -44,6 +44,34 @@ static int timezone_set(const char *new_tz) {
   return 0;
 }
 
+/* Times the lookup done when the applet starts and on each change, the
+ * first one may have to build the zoneinfo index */
+static void timezone_time(int iterations) {
+  SystemTimezone *systz;
+  gint64 start;
+  gint64 first;
+  int i;
+
+  start = g_get_monotonic_time();
+  systz = system_timezone_new();
+  first = g_get_monotonic_time() - start;
+  g_print("Current timezone: %s\n", system_timezone_get(systz));
+  g_object_unref(systz);
+
+  g_print("First lookup: %.3f ms\n", first / 1000.0);
+
+  if (iterations <= 0) return;
+
+  start = g_get_monotonic_time();
+  for (i = 0; i < iterations; i++) {
+    systz = system_timezone_new();
+    g_object_unref(systz);
+  }
+
+  g_print("Next lookups: %.3f ms on average over %d\n",
+          (g_get_monotonic_time() - start) / 1000.0 / iterations, iterations);
+}
+
 static void timezone_changed(SystemTimezone *systz, const char *new_tz,
                              gpointer data) {
   g_print("Timezone changed to: %s\n", new_tz);
@@ -68,6 +96,7 @@ int main(int argc, char **argv) {
 
   gboolean get = FALSE;
   gboolean monitor = FALSE;
+  int time_iterations = -1;
   char *tz_set = NULL;
 
   GError *error;
@@ -78,6 +107,9 @@ int main(int argc, char **argv) {
                              "Set the timezone to TIMEZONE", "TIMEZONE"},
                             {"monitor", 'm', 0, G_OPTION_ARG_NONE, &monitor,
                              "Monitor timezone changes", NULL},
+                            {"time", 't', 0, G_OPTION_ARG_INT,
+                             &time_iterations,
+                             "Time N lookups of the current timezone", "N"},
                             {NULL, 0, 0, 0, NULL, NULL, NULL}};
 
   retval = 0;
@@ -96,7 +128,9 @@ int main(int argc, char **argv) {
 
   g_option_context_free(context);
 
-  if (get || (!tz_set && !monitor))
+  if (time_iterations >= 0)
+    timezone_time(time_iterations);
+  else if (get || (!tz_set && !monitor))
     timezone_print();
   else if (tz_set)
     retval = timezone_set(tz_set);
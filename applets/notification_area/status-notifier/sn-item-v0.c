@@ -26,6 +26,7 @@
 
 #include "sn-item-v0-gen.h"
 #include "sn-item.h"
+#include "sn-pixmap.h"
 
 #define SN_ITEM_INTERFACE "org.kde.StatusNotifierItem"
 
@@ -71,9 +72,43 @@ struct _SnItemV0 {
   gchar *menu;
   gboolean item_is_menu;
 
+  /* the values the pixmaps and tooltip were built from */
+  GVariant *icon_pixmap_variant;
+  GVariant *overlay_icon_pixmap_variant;
+  GVariant *attention_icon_pixmap_variant;
+  GVariant *tooltip_variant;
+
+  /* DIRTY_* flags of the properties to fetch */
+  guint dirty;
+  guint fetch_id;
+
   guint update_id;
 };
 
+/* The New* signals carry no value: the properties they are about are
+ * marked dirty and fetched together, once per frame */
+enum {
+  DIRTY_TITLE = 1 << 0,
+  DIRTY_ICON = 1 << 1,
+  DIRTY_OVERLAY_ICON = 1 << 2,
+  DIRTY_ATTENTION_ICON = 1 << 3,
+  DIRTY_TOOLTIP = 1 << 4
+};
+
+static const struct {
+  const gchar *name;
+  guint dirty;
+} fetched_properties[] = {{"Title", DIRTY_TITLE},
+                          {"IconName", DIRTY_ICON},
+                          {"IconPixmap", DIRTY_ICON},
+                          {"OverlayIconName", DIRTY_OVERLAY_ICON},
+                          {"OverlayIconPixmap", DIRTY_OVERLAY_ICON},
+                          {"AttentionIconName", DIRTY_ATTENTION_ICON},
+                          {"AttentionIconPixmap", DIRTY_ATTENTION_ICON},
+                          {"ToolTip", DIRTY_TOOLTIP}};
+
+#define FETCH_DELAY 16
+
 enum {
   PROP_0,
 
@@ -323,72 +358,25 @@ static void queue_update(SnItemV0 *v0) {
   g_source_set_name_by_id(v0->update_id, "[status-notifier] update_cb");
 }
 
-static cairo_surface_t *surface_from_variant(GVariant *variant, gint width,
-                                             gint height) {
-  cairo_format_t format;
-  gint stride;
-  guint32 *data;
-  gint x;
-  gint y;
-  guchar *p;
-
-  format = CAIRO_FORMAT_ARGB32;
-  stride = cairo_format_stride_for_width(format, width);
-  data = (guint32 *)g_variant_get_data(variant);
-
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-  {
-    gint i;
-
-    for (i = 0; i < width * height; i++) data[i] = GUINT32_FROM_BE(data[i]);
-  }
-#endif
-
-  p = (guchar *)data;
-  /* premultiply alpha for Cairo */
-  for (y = 0; y < height; y++) {
-    for (x = 0; x < width; x++) {
-      guchar alpha = p[x * 4 + 3];
-
-      p[x * 4 + 0] = (p[x * 4 + 0] * alpha) / 255;
-      p[x * 4 + 1] = (p[x * 4 + 1] * alpha) / 255;
-      p[x * 4 + 2] = (p[x * 4 + 2] * alpha) / 255;
-    }
-
-    p += stride;
-  }
-
-  return cairo_image_surface_create_for_data((guchar *)data, format, width,
-                                             height, stride);
-}
-
 static cairo_surface_t *icon_surface_new(GVariant *variant, gint width,
                                          gint height) {
   cairo_surface_t *surface;
-  cairo_surface_t *tmp;
-  cairo_t *cr;
 
-  surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
-  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) return NULL;
-
-  tmp = surface_from_variant(variant, width, height);
-  if (cairo_surface_status(tmp) != CAIRO_STATUS_SUCCESS) {
-    cairo_surface_destroy(surface);
+  if (width <= 0 || height <= 0 ||
+      g_variant_get_size(variant) < (gsize)width * height * 4)
     return NULL;
-  }
 
-  cr = cairo_create(surface);
-  if (cairo_status(cr) != CAIRO_STATUS_SUCCESS) {
+  surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
     cairo_surface_destroy(surface);
-    cairo_surface_destroy(tmp);
     return NULL;
   }
 
-  cairo_set_source_surface(cr, tmp, 0, 0);
-  cairo_paint(cr);
-
-  cairo_surface_destroy(tmp);
-  cairo_destroy(cr);
+  cairo_surface_flush(surface);
+  sn_pixmap_to_cairo(g_variant_get_data(variant), width, height,
+                     cairo_image_surface_get_data(surface),
+                     cairo_image_surface_get_stride(surface));
+  cairo_surface_mark_dirty(surface);
 
   return surface;
 }
@@ -487,221 +475,203 @@ static void sn_tooltip_free(SnTooltip *tooltip) {
   g_free(tooltip);
 }
 
-static GVariant *get_property(GObject *source_object, GAsyncResult *res,
-                              gpointer user_data, gboolean *cancelled) {
-  GVariant *variant;
-  GError *error;
-  GVariant *property;
+static gboolean set_string(gchar **field, GVariant *value) {
+  const gchar *string = NULL;
 
-  error = NULL;
-  variant = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res,
-                                          &error);
+  if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+    string = g_variant_get_string(value, NULL);
 
-  *cancelled = FALSE;
-  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-    *cancelled = TRUE;
-    g_error_free(error);
-    return NULL;
-  }
-
-  if (g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS)) {
-    g_error_free(error);
-    return NULL;
-  }
-
-  if (error) {
-    g_warning("%s", error->message);
-    g_error_free(error);
-    return NULL;
-  }
+  if (g_strcmp0(*field, string) == 0) return FALSE;
 
-  g_variant_get(variant, "(v)", &property);
-  g_variant_unref(variant);
+  g_free(*field);
+  *field = g_strdup(string);
 
-  return property;
+  return TRUE;
 }
 
-static void update_property(SnItemV0 *v0, const gchar *property,
-                            GAsyncReadyCallback callback) {
-  GDBusProxy *proxy;
-  SnItem *item;
+/* Returns FALSE if value is the one the pixmap was built from */
+static gboolean set_pixmap(SnIconPixmap ***pixmap, GVariant **pixmap_variant,
+                           GVariant *value) {
+  if (*pixmap_variant == value) return FALSE;
+  if (*pixmap_variant && value && g_variant_equal(*pixmap_variant, value))
+    return FALSE;
 
-  proxy = G_DBUS_PROXY(v0->proxy);
-  item = SN_ITEM(v0);
+  g_clear_pointer(pixmap_variant, g_variant_unref);
+  if (value) *pixmap_variant = g_variant_ref(value);
 
-  g_dbus_connection_call(
-      g_dbus_proxy_get_connection(proxy), sn_item_get_bus_name(item),
-      sn_item_get_object_path(item), "org.freedesktop.DBus.Properties", "Get",
-      g_variant_new("(ss)", SN_ITEM_INTERFACE, property), G_VARIANT_TYPE("(v)"),
-      G_DBUS_CALL_FLAGS_NONE, -1, v0->cancellable, callback, v0);
-}
+  icon_pixmap_free(*pixmap);
+  *pixmap = icon_pixmap_new(value);
 
-static void update_title(GObject *source_object, GAsyncResult *res,
-                         gpointer user_data) {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  return TRUE;
+}
 
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
+static gboolean set_tooltip(SnItemV0 *v0, GVariant *value) {
+  if (v0->tooltip_variant == value) return FALSE;
+  if (v0->tooltip_variant && value &&
+      g_variant_equal(v0->tooltip_variant, value))
+    return FALSE;
 
-  v0 = SN_ITEM_V0(user_data);
+  g_clear_pointer(&v0->tooltip_variant, g_variant_unref);
+  if (value) v0->tooltip_variant = g_variant_ref(value);
 
-  g_free(v0->title);
-  v0->title = g_variant_dup_string(variant, NULL);
-  g_clear_pointer(&variant, g_variant_unref);
+  sn_tooltip_free(v0->tooltip);
+  v0->tooltip = sn_tooltip_new(value);
 
-  queue_update(v0);
+  return TRUE;
 }
 
-static void new_title_cb(SnItemV0 *v0) {
-  update_property(v0, "Title", update_title);
+/* Returns TRUE if the item needs to be updated */
+static gboolean update_from_property(SnItemV0 *v0, const gchar *property,
+                                     GVariant *value) {
+  if (g_strcmp0(property, "Title") == 0)
+    return set_string(&v0->title, value);
+  else if (g_strcmp0(property, "IconName") == 0)
+    return set_string(&v0->icon_name, value);
+  else if (g_strcmp0(property, "IconPixmap") == 0)
+    return set_pixmap(&v0->icon_pixmap, &v0->icon_pixmap_variant, value);
+  else if (g_strcmp0(property, "OverlayIconName") == 0)
+    return set_string(&v0->overlay_icon_name, value);
+  else if (g_strcmp0(property, "OverlayIconPixmap") == 0)
+    return set_pixmap(&v0->overlay_icon_pixmap,
+                      &v0->overlay_icon_pixmap_variant, value);
+  else if (g_strcmp0(property, "AttentionIconName") == 0)
+    return set_string(&v0->attention_icon_name, value);
+  else if (g_strcmp0(property, "AttentionIconPixmap") == 0)
+    return set_pixmap(&v0->attention_icon_pixmap,
+                      &v0->attention_icon_pixmap_variant, value);
+  else if (g_strcmp0(property, "ToolTip") == 0)
+    return set_tooltip(v0, value);
+
+  return FALSE;
 }
 
-static void update_icon_name(GObject *source_object, GAsyncResult *res,
-                             gpointer user_data) {
+typedef struct {
   SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
-
-  v0 = SN_ITEM_V0(user_data);
-
-  g_free(v0->icon_name);
-  v0->icon_name = g_variant_dup_string(variant, NULL);
-  g_clear_pointer(&variant, g_variant_unref);
-
-  queue_update(v0);
-}
-
-static void update_icon_pixmap(GObject *source_object, GAsyncResult *res,
-                               gpointer user_data) {
+  guint dirty;
+  /* the only property fetched, or NULL if they all were */
+  const gchar *property;
+} FetchData;
+
+static void fetch_properties_cb(GObject *source_object, GAsyncResult *res,
+                                gpointer user_data) {
+  FetchData *data;
   SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  GVariant *reply;
+  GError *error;
+  gboolean invalid_args;
+  gboolean changed;
+  gsize i;
 
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
+  data = user_data;
 
-  v0 = SN_ITEM_V0(user_data);
+  error = NULL;
+  reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res,
+                                        &error);
 
-  g_clear_pointer(&v0->icon_pixmap, icon_pixmap_free);
-  v0->icon_pixmap = icon_pixmap_new(variant);
-  g_clear_pointer(&variant, g_variant_unref);
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    g_error_free(error);
+    g_free(data);
+    return;
+  }
 
-  queue_update(v0);
-}
+  v0 = data->v0;
+  invalid_args =
+      g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS);
+  changed = FALSE;
 
-static void new_icon_cb(SnItemV0 *v0) {
-  update_property(v0, "IconName", update_icon_name);
-  update_property(v0, "IconPixmap", update_icon_pixmap);
-}
+  if (data->property != NULL) {
+    GVariant *value = NULL;
 
-static void update_overlay_icon_name(GObject *source_object, GAsyncResult *res,
-                                     gpointer user_data) {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+    /* InvalidArgs: the item does not have the property (anymore) */
+    if (reply) g_variant_get(reply, "(v)", &value);
+    if (reply || invalid_args)
+      changed = update_from_property(v0, data->property, value);
 
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
+    g_clear_pointer(&value, g_variant_unref);
+  } else if (reply) {
+    GVariant *properties;
 
-  v0 = SN_ITEM_V0(user_data);
+    properties = g_variant_get_child_value(reply, 0);
 
-  g_free(v0->overlay_icon_name);
-  v0->overlay_icon_name = g_variant_dup_string(variant, NULL);
-  g_clear_pointer(&variant, g_variant_unref);
+    for (i = 0; i < G_N_ELEMENTS(fetched_properties); i++) {
+      GVariant *value;
 
-  queue_update(v0);
-}
-
-static void update_overlay_icon_pixmap(GObject *source_object,
-                                       GAsyncResult *res, gpointer user_data) {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+      if (!(fetched_properties[i].dirty & data->dirty)) continue;
 
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
+      value = g_variant_lookup_value(properties, fetched_properties[i].name,
+                                     NULL);
+      if (update_from_property(v0, fetched_properties[i].name, value))
+        changed = TRUE;
+      g_clear_pointer(&value, g_variant_unref);
+    }
 
-  v0 = SN_ITEM_V0(user_data);
+    g_variant_unref(properties);
+  }
 
-  g_clear_pointer(&v0->overlay_icon_pixmap, icon_pixmap_free);
-  v0->overlay_icon_pixmap = icon_pixmap_new(variant);
-  g_clear_pointer(&variant, g_variant_unref);
+  if (error && !invalid_args) g_warning("%s", error->message);
 
-  queue_update(v0);
-}
+  g_clear_error(&error);
+  g_clear_pointer(&reply, g_variant_unref);
+  g_free(data);
 
-static void new_overlay_icon_cb(SnItemV0 *v0) {
-  update_property(v0, "OverlayIconName", update_overlay_icon_name);
-  update_property(v0, "OverlayIconPixmap", update_overlay_icon_pixmap);
+  if (changed) queue_update(v0);
 }
 
-static void update_attention_icon_name(GObject *source_object,
-                                       GAsyncResult *res, gpointer user_data) {
+static gboolean fetch_properties(gpointer user_data) {
   SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
+  FetchData *data;
+  SnItem *item;
+  GDBusConnection *connection;
+  gsize i;
 
   v0 = SN_ITEM_V0(user_data);
+  item = SN_ITEM(v0);
+  v0->fetch_id = 0;
 
-  g_free(v0->attention_icon_name);
-  v0->attention_icon_name = g_variant_dup_string(variant, NULL);
-  g_clear_pointer(&variant, g_variant_unref);
-
-  queue_update(v0);
-}
+  data = g_new0(FetchData, 1);
+  data->v0 = v0;
+  data->dirty = v0->dirty;
+  v0->dirty = 0;
 
-static void update_attention_icon_pixmap(GObject *source_object,
-                                         GAsyncResult *res,
-                                         gpointer user_data) {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  /* a single property is cheaper to Get than all of them */
+  for (i = 0; i < G_N_ELEMENTS(fetched_properties); i++) {
+    if (!(fetched_properties[i].dirty & data->dirty)) continue;
 
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
+    if (data->property != NULL) {
+      data->property = NULL;
+      break;
+    }
 
-  v0 = SN_ITEM_V0(user_data);
+    data->property = fetched_properties[i].name;
+  }
 
-  icon_pixmap_free(v0->attention_icon_pixmap);
-  v0->attention_icon_pixmap = icon_pixmap_new(variant);
-  g_clear_pointer(&variant, g_variant_unref);
+  connection = g_dbus_proxy_get_connection(G_DBUS_PROXY(v0->proxy));
 
-  queue_update(v0);
-}
+  if (data->property != NULL)
+    g_dbus_connection_call(
+        connection, sn_item_get_bus_name(item), sn_item_get_object_path(item),
+        "org.freedesktop.DBus.Properties", "Get",
+        g_variant_new("(ss)", SN_ITEM_INTERFACE, data->property),
+        G_VARIANT_TYPE("(v)"), G_DBUS_CALL_FLAGS_NONE, -1, v0->cancellable,
+        fetch_properties_cb, data);
+  else
+    g_dbus_connection_call(
+        connection, sn_item_get_bus_name(item), sn_item_get_object_path(item),
+        "org.freedesktop.DBus.Properties", "GetAll",
+        g_variant_new("(s)", SN_ITEM_INTERFACE), G_VARIANT_TYPE("(a{sv})"),
+        G_DBUS_CALL_FLAGS_NONE, -1, v0->cancellable, fetch_properties_cb,
+        data);
 
-static void new_attention_icon_cb(SnItemV0 *v0) {
-  update_property(v0, "AttentionIconName", update_attention_icon_name);
-  update_property(v0, "AttentionIconPixmap", update_attention_icon_pixmap);
+  return G_SOURCE_REMOVE;
 }
 
-static void update_tooltip(GObject *source_object, GAsyncResult *res,
-                           gpointer user_data) {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property(source_object, res, user_data, &cancelled);
-  if (cancelled) return;
-
-  v0 = SN_ITEM_V0(user_data);
-
-  sn_tooltip_free(v0->tooltip);
-  v0->tooltip = sn_tooltip_new(variant);
-  g_clear_pointer(&variant, g_variant_unref);
+static void queue_fetch(SnItemV0 *v0, guint dirty) {
+  v0->dirty |= dirty;
 
-  queue_update(v0);
-}
+  if (v0->fetch_id != 0) return;
 
-static void new_tooltip_cb(SnItemV0 *v0) {
-  update_property(v0, "ToolTip", update_tooltip);
+  v0->fetch_id = g_timeout_add(FETCH_DELAY, fetch_properties, v0);
+  g_source_set_name_by_id(v0->fetch_id, "[status-notifier] fetch_properties");
 }
 
 static void new_status_cb(SnItemV0 *v0, GVariant *parameters) {
@@ -753,25 +723,39 @@ static void g_properties_changed_cb(GDBusProxy *proxy,
                                     GStrv invalidated_properties,
                                     SnItemV0 *v0) {
   gchar *debug;
+  GVariantIter iter;
+  const gchar *key;
+  GVariant *value;
+  gboolean changed;
 
   debug = g_variant_print(changed_properties, FALSE);
   g_debug("g_properties_changed_cb: %s", debug);
   g_free(debug);
+
+  /* items emitting it with the values save us the round-trip */
+  changed = FALSE;
+  g_variant_iter_init(&iter, changed_properties);
+  while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+    if (update_from_property(v0, key, value)) changed = TRUE;
+    g_variant_unref(value);
+  }
+
+  if (changed) queue_update(v0);
 }
 
 static void g_signal_cb(GDBusProxy *proxy, gchar *sender_name,
                         gchar *signal_name, GVariant *parameters,
                         SnItemV0 *v0) {
   if (g_strcmp0(signal_name, "NewTitle") == 0)
-    new_title_cb(v0);
+    queue_fetch(v0, DIRTY_TITLE);
   else if (g_strcmp0(signal_name, "NewIcon") == 0)
-    new_icon_cb(v0);
+    queue_fetch(v0, DIRTY_ICON);
   else if (g_strcmp0(signal_name, "NewOverlayIcon") == 0)
-    new_overlay_icon_cb(v0);
+    queue_fetch(v0, DIRTY_OVERLAY_ICON);
   else if (g_strcmp0(signal_name, "NewAttentionIcon") == 0)
-    new_attention_icon_cb(v0);
+    queue_fetch(v0, DIRTY_ATTENTION_ICON);
   else if (g_strcmp0(signal_name, "NewToolTip") == 0)
-    new_tooltip_cb(v0);
+    queue_fetch(v0, DIRTY_TOOLTIP);
   else if (g_strcmp0(signal_name, "NewStatus") == 0)
     new_status_cb(v0, parameters);
   else if (g_strcmp0(signal_name, "NewIconThemePath") == 0)
@@ -823,19 +807,21 @@ static void get_all_cb(GObject *source_object, GAsyncResult *res,
     else if (g_strcmp0(key, "IconName") == 0)
       v0->icon_name = g_variant_dup_string(value, NULL);
     else if (g_strcmp0(key, "IconPixmap") == 0)
-      v0->icon_pixmap = icon_pixmap_new(value);
+      set_pixmap(&v0->icon_pixmap, &v0->icon_pixmap_variant, value);
     else if (g_strcmp0(key, "OverlayIconName") == 0)
       v0->overlay_icon_name = g_variant_dup_string(value, NULL);
     else if (g_strcmp0(key, "OverlayIconPixmap") == 0)
-      v0->overlay_icon_pixmap = icon_pixmap_new(value);
+      set_pixmap(&v0->overlay_icon_pixmap, &v0->overlay_icon_pixmap_variant,
+                 value);
     else if (g_strcmp0(key, "AttentionIconName") == 0)
       v0->attention_icon_name = g_variant_dup_string(value, NULL);
     else if (g_strcmp0(key, "AttentionIconPixmap") == 0)
-      v0->attention_icon_pixmap = icon_pixmap_new(value);
+      set_pixmap(&v0->attention_icon_pixmap,
+                 &v0->attention_icon_pixmap_variant, value);
     else if (g_strcmp0(key, "AttentionMovieName") == 0)
       v0->attention_movie_name = g_variant_dup_string(value, NULL);
     else if (g_strcmp0(key, "ToolTip") == 0)
-      v0->tooltip = sn_tooltip_new(value);
+      set_tooltip(v0, value);
     else if (g_strcmp0(key, "IconThemePath") == 0)
       v0->icon_theme_path = g_variant_dup_string(value, NULL);
     else if (g_strcmp0(key, "Menu") == 0)
@@ -945,6 +931,11 @@ static void sn_item_v0_dispose(GObject *object) {
     v0->update_id = 0;
   }
 
+  if (v0->fetch_id != 0) {
+    g_source_remove(v0->fetch_id);
+    v0->fetch_id = 0;
+  }
+
   G_OBJECT_CLASS(sn_item_v0_parent_class)->dispose(object);
 }
 
@@ -970,6 +961,11 @@ static void sn_item_v0_finalize(GObject *object) {
   g_clear_pointer(&v0->icon_theme_path, g_free);
   g_clear_pointer(&v0->menu, g_free);
 
+  g_clear_pointer(&v0->icon_pixmap_variant, g_variant_unref);
+  g_clear_pointer(&v0->overlay_icon_pixmap_variant, g_variant_unref);
+  g_clear_pointer(&v0->attention_icon_pixmap_variant, g_variant_unref);
+  g_clear_pointer(&v0->tooltip_variant, g_variant_unref);
+
   G_OBJECT_CLASS(sn_item_v0_parent_class)->finalize(object);
 }
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "sn-pixmap.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The IconPixmap pixels are ARGB32 in network byte order, that is the
+ * bytes A, R, G, B, not premultiplied. Cairo wants native endian ARGB32
+ * with premultiplied alpha: both conversions are done in a single pass
+ * straight into the surface data.
+ *
+ * x * a / 255 is computed with rounding as (t + (t >> 8)) >> 8 where
+ * t = x * a + 128, which is exact for 8 bits values. */
+
+static inline guint8 sn_pixmap_premultiply(guint8 x, guint8 a) {
+  guint t = x * a + 128;
+
+  return (t + (t >> 8)) >> 8;
+}
+
+static inline void sn_pixmap_row_generic(const guchar *src, guint32 *dest,
+                                         gint width) {
+  gint x;
+
+  for (x = 0; x < width; x++, src += 4) {
+    guint8 a = src[0];
+
+    dest[x] = ((guint32)a << 24) |
+              ((guint32)sn_pixmap_premultiply(src[1], a) << 16) |
+              ((guint32)sn_pixmap_premultiply(src[2], a) << 8) |
+              (guint32)sn_pixmap_premultiply(src[3], a);
+  }
+}
+
+void sn_pixmap_to_cairo_generic(const guchar *src, gint width, gint height,
+                                guchar *dest, gint dest_stride) {
+  gint y;
+
+  for (y = 0; y < height; y++) {
+    sn_pixmap_row_generic(src, (guint32 *)dest, width);
+
+    src += width * 4;
+    dest += dest_stride;
+  }
+}
+
+#ifdef __SSE2__
+/* Four pixels of ABGR... 16 bits lanes, reversed to B, G, R, A and
+ * premultiplied; the alpha lane is multiplied by 255, which keeps it. */
+static inline __m128i sn_pixmap_premultiply_sse2(__m128i pixels) {
+  const __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  const __m128i alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const __m128i half = _mm_set1_epi16(128);
+  __m128i alpha;
+  __m128i t;
+
+  /* A R G B -> B G R A in both halves */
+  pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(0, 1, 2, 3));
+  pixels = _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(0, 1, 2, 3));
+
+  alpha = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm_or_si128(_mm_and_si128(alpha, rgb_mask), alpha_one);
+
+  t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), half);
+
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void sn_pixmap_to_cairo_sse2(const guchar *src, gint width, gint height,
+                                    guchar *dest, gint dest_stride) {
+  const __m128i zero = _mm_setzero_si128();
+  gint y;
+
+  for (y = 0; y < height; y++) {
+    const guchar *s = src;
+    guchar *d = dest;
+    gint x;
+
+    for (x = 0; x + 4 <= width; x += 4, s += 16, d += 16) {
+      __m128i pixels = _mm_loadu_si128((const __m128i *)s);
+      __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+      __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+
+      lo = sn_pixmap_premultiply_sse2(lo);
+      hi = sn_pixmap_premultiply_sse2(hi);
+
+      _mm_storeu_si128((__m128i *)d, _mm_packus_epi16(lo, hi));
+    }
+
+    sn_pixmap_row_generic(s, (guint32 *)d, width - x);
+
+    src += width * 4;
+    dest += dest_stride;
+  }
+}
+#endif
+
+/* Converts a width x height IconPixmap to the data of a cairo ARGB32
+ * image surface, whose rows are dest_stride bytes long */
+void sn_pixmap_to_cairo(const guchar *src, gint width, gint height,
+                        guchar *dest, gint dest_stride) {
+  /* SSE2 is always there on x86-64; the vector code writes the bytes in
+   * little endian order, which is also always the case there */
+#if defined(__SSE2__) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+  sn_pixmap_to_cairo_sse2(src, width, height, dest, dest_stride);
+#else
+  sn_pixmap_to_cairo_generic(src, width, height, dest, dest_stride);
+#endif
+}
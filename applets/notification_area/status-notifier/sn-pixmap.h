@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SN_PIXMAP_H
+#define SN_PIXMAP_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void sn_pixmap_to_cairo(const guchar *src, gint width, gint height,
+                        guchar *dest, gint dest_stride);
+
+void sn_pixmap_to_cairo_generic(const guchar *src, gint width, gint height,
+                                guchar *dest, gint dest_stride);
+
+G_END_DECLS
+
+#endif
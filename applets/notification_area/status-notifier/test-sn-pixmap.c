@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks the IconPixmap conversion against the generic code, and times
+ * both for common icon sizes:
+ *
+ *   test-sn-pixmap [ITERATIONS]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sn-pixmap.h"
+
+typedef void (*ConvertFunc)(const guchar *src, gint width, gint height,
+                            guchar *dest, gint dest_stride);
+
+static gdouble time_convert(ConvertFunc convert, const guchar *src, gint size,
+                            guchar *dest, gint stride, gint iterations) {
+  gint64 start;
+  gint i;
+
+  start = g_get_monotonic_time();
+  for (i = 0; i < iterations; i++) convert(src, size, size, dest, stride);
+
+  return (gdouble)(g_get_monotonic_time() - start) * 1000.0 / iterations;
+}
+
+int main(int argc, char *argv[]) {
+  const gint sizes[] = {16, 22, 24, 32, 48, 64, 128, 256};
+  gint iterations = 10000;
+  gboolean failed = FALSE;
+  guint i;
+
+  if (argc > 1) iterations = MAX(1, atoi(argv[1]));
+
+  g_print("%6s %14s %14s\n", "size", "generic (ns)", "default (ns)");
+
+  for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+    gint size = sizes[i];
+    /* like cairo's, keep the rows aligned and a bit larger */
+    gint stride = (size * 4 + 15) & ~15;
+    guchar *src;
+    guchar *expected;
+    guchar *dest;
+    gdouble generic_ns;
+    gdouble default_ns;
+    gint j;
+
+    src = g_malloc(size * size * 4);
+    expected = g_malloc0(stride * size);
+    dest = g_malloc0(stride * size);
+
+    for (j = 0; j < size * size * 4; j++) src[j] = g_random_int_range(0, 256);
+    /* fully opaque and fully transparent pixels are the common case */
+    for (j = 0; j < size * size; j += 3) src[j * 4] = (j % 2) ? 0xff : 0x00;
+
+    sn_pixmap_to_cairo_generic(src, size, size, expected, stride);
+    sn_pixmap_to_cairo(src, size, size, dest, stride);
+
+    if (memcmp(expected, dest, stride * size) != 0) {
+      g_printerr("Conversion mismatch for %dx%d\n", size, size);
+      failed = TRUE;
+    }
+
+    generic_ns = time_convert(sn_pixmap_to_cairo_generic, src, size, dest,
+                              stride, iterations);
+    default_ns =
+        time_convert(sn_pixmap_to_cairo, src, size, dest, stride, iterations);
+
+    g_print("%6d %14.0f %14.0f\n", size, generic_ns, default_ns);
+
+    g_free(src);
+    g_free(expected);
+    g_free(dest);
+  }
+
+  return failed ? 1 : 0;
+}
@@ -38,6 +38,14 @@
 #define NOTIFICATION_AREA_ICON "mate-panel-notification-area"
 
 static guint n_windows = 0;
+static gint n_stress_updates = 0;
+
+static GOptionEntry entries[] = {
+    {"stress", 0, 0, G_OPTION_ARG_INT, &n_stress_updates,
+     "Update a test status notifier item N times and count the property "
+     "calls the tray makes for it",
+     "N"},
+    {NULL}};
 
 typedef struct {
   GdkScreen *screen;
@@ -190,6 +198,166 @@ static TrayData *create_tray_on_screen(GdkScreen *screen, gboolean force) {
   return data;
 }
 
+/* The stress test item: its icon and tooltip change with every update, and
+ * each update is announced with both NewIcon and NewToolTip, as many
+ * applications do */
+#define STRESS_ITEM_PATH "/org/mate/panel/TestTray/StatusNotifierItem"
+#define STRESS_ITEM_INTERFACE "org.kde.StatusNotifierItem"
+#define STRESS_ICON_SIZE 16
+
+static const gchar stress_item_xml[] =
+    "<node>"
+    "  <interface name='" STRESS_ITEM_INTERFACE "'>"
+    "    <property name='Category' type='s' access='read'/>"
+    "    <property name='Id' type='s' access='read'/>"
+    "    <property name='Title' type='s' access='read'/>"
+    "    <property name='Status' type='s' access='read'/>"
+    "    <property name='IconPixmap' type='a(iiay)' access='read'/>"
+    "    <property name='ToolTip' type='(sa(iiay)ss)' access='read'/>"
+    "    <signal name='NewIcon'/>"
+    "    <signal name='NewToolTip'/>"
+    "  </interface>"
+    "</node>";
+
+static GDBusConnection *stress_connection = NULL;
+static guint stress_n_updates = 0;
+/* Properties calls made by this process, counted from the filter thread */
+static gint stress_n_calls = 0;
+
+static GVariant *stress_icon_pixmap_new(void) {
+  guchar data[STRESS_ICON_SIZE * STRESS_ICON_SIZE * 4];
+  GVariantBuilder builder;
+  gsize i;
+
+  /* ARGB32, in network byte order */
+  for (i = 0; i < sizeof(data); i += 4) {
+    data[i] = 0xff;
+    data[i + 1] = stress_n_updates * 37;
+    data[i + 2] = stress_n_updates * 59;
+    data[i + 3] = stress_n_updates * 83;
+  }
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a(iiay)"));
+  g_variant_builder_add(
+      &builder, "(ii@ay)", STRESS_ICON_SIZE, STRESS_ICON_SIZE,
+      g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, data, sizeof(data), 1));
+
+  return g_variant_builder_end(&builder);
+}
+
+static GVariant *stress_get_property(GDBusConnection *connection,
+                                     const gchar *sender,
+                                     const gchar *object_path,
+                                     const gchar *interface_name,
+                                     const gchar *property_name,
+                                     GError **error, gpointer user_data) {
+  if (g_strcmp0(property_name, "Category") == 0)
+    return g_variant_new_string("ApplicationStatus");
+  else if (g_strcmp0(property_name, "Id") == 0)
+    return g_variant_new_string("testtray-stress");
+  else if (g_strcmp0(property_name, "Title") == 0)
+    return g_variant_new_string("Test Tray");
+  else if (g_strcmp0(property_name, "Status") == 0)
+    return g_variant_new_string("Active");
+  else if (g_strcmp0(property_name, "IconPixmap") == 0)
+    return stress_icon_pixmap_new();
+  else if (g_strcmp0(property_name, "ToolTip") == 0) {
+    char text[64];
+
+    g_snprintf(text, sizeof(text), "Update %u", stress_n_updates);
+
+    return g_variant_new("(s@a(iiay)ss)", "",
+                         g_variant_new_array(G_VARIANT_TYPE("(iiay)"), NULL, 0),
+                         "Test Tray", text);
+  }
+
+  g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+              "No such property: %s", property_name);
+  return NULL;
+}
+
+static GDBusMessage *stress_filter(GDBusConnection *connection,
+                                   GDBusMessage *message, gboolean incoming,
+                                   gpointer user_data) {
+  if (incoming &&
+      g_dbus_message_get_message_type(message) ==
+          G_DBUS_MESSAGE_TYPE_METHOD_CALL &&
+      g_strcmp0(g_dbus_message_get_interface(message),
+                "org.freedesktop.DBus.Properties") == 0 &&
+      g_strcmp0(g_dbus_message_get_path(message), STRESS_ITEM_PATH) == 0 &&
+      g_strcmp0(g_dbus_message_get_sender(message),
+                g_dbus_connection_get_unique_name(connection)) == 0)
+    g_atomic_int_inc(&stress_n_calls);
+
+  return message;
+}
+
+static gboolean stress_report(gpointer data) {
+  gint n_calls = g_atomic_int_get(&stress_n_calls);
+
+  g_print("[Stress] %u updates, %d property calls (%.2f per update)\n",
+          stress_n_updates, n_calls, (double)n_calls / stress_n_updates);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean stress_update(gpointer data) {
+  stress_n_updates++;
+
+  g_dbus_connection_emit_signal(stress_connection, NULL, STRESS_ITEM_PATH,
+                                STRESS_ITEM_INTERFACE, "NewIcon", NULL, NULL);
+  g_dbus_connection_emit_signal(stress_connection, NULL, STRESS_ITEM_PATH,
+                                STRESS_ITEM_INTERFACE, "NewToolTip", NULL,
+                                NULL);
+
+  if (stress_n_updates < (guint)n_stress_updates) return G_SOURCE_CONTINUE;
+
+  /* let the last fetches complete */
+  g_timeout_add_seconds(1, stress_report, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean stress_begin(gpointer data) {
+  /* do not count the calls made when the item was added */
+  g_atomic_int_set(&stress_n_calls, 0);
+  g_timeout_add(100, stress_update, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean stress_start(gpointer data) {
+  static const GDBusInterfaceVTable vtable = {NULL, stress_get_property, NULL};
+  GDBusNodeInfo *node_info;
+  GError *error = NULL;
+
+  stress_connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+  if (stress_connection == NULL) {
+    g_warning("Failed to get the session bus: %s", error->message);
+    g_error_free(error);
+    return G_SOURCE_REMOVE;
+  }
+
+  node_info = g_dbus_node_info_new_for_xml(stress_item_xml, NULL);
+  g_dbus_connection_register_object(stress_connection, STRESS_ITEM_PATH,
+                                    node_info->interfaces[0], &vtable, NULL,
+                                    NULL, NULL);
+  g_dbus_node_info_unref(node_info);
+
+  g_dbus_connection_add_filter(stress_connection, stress_filter, NULL, NULL);
+
+  g_dbus_connection_call(
+      stress_connection, "org.kde.StatusNotifierWatcher",
+      "/StatusNotifierWatcher", "org.kde.StatusNotifierWatcher",
+      "RegisterStatusNotifierItem", g_variant_new("(s)", STRESS_ITEM_PATH),
+      NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL, NULL);
+
+  g_print("[Stress] Updating the test item %d times\n", n_stress_updates);
+  g_timeout_add_seconds(1, stress_begin, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
 static gboolean signal_handler(gpointer data) {
   gtk_main_quit();
 
@@ -233,8 +401,13 @@ int main(int argc, char *argv[]) {
 #ifdef PROVIDE_WATCHER_SERVICE
   GfStatusNotifierWatcher *service;
 #endif
+  GError *error = NULL;
 
-  gtk_init(&argc, &argv);
+  if (!gtk_init_with_args(&argc, &argv, NULL, entries, NULL, &error)) {
+    g_printerr("%s\n", error->message);
+    g_error_free(error);
+    return 1;
+  }
 
   g_unix_signal_add(SIGTERM, signal_handler, NULL);
   g_unix_signal_add(SIGINT, signal_handler, NULL);
@@ -250,6 +423,9 @@ int main(int argc, char *argv[]) {
 
   create_tray_on_screen(screen, FALSE);
 
+  /* once the watcher is up */
+  if (n_stress_updates > 0) g_timeout_add_seconds(1, stress_start, NULL);
+
   gtk_main();
 
 #ifdef PROVIDE_WATCHER_SERVICE
@@ -35,6 +35,7 @@
 #include <libmate-desktop/mate-desktop-utils.h>
 
 #include "window-list.h"
+#include "window-thumbnail-cache.h"
 #include "wncklet.h"
 
 #define WINDOW_LIST_ICON "mate-panel-window-list"
@@ -55,6 +56,7 @@ typedef struct {
   GtkWidget* tasklist;
 #ifdef HAVE_WINDOW_PREVIEWS
   GtkWidget* preview;
+  WindowThumbnailCache* thumbnail_cache;
 
   gboolean show_window_thumbnails;
   gint thumbnail_size;
@@ -241,61 +243,28 @@ static void applet_change_background(MatePanelApplet* applet,
 
 #ifdef HAVE_X11
 #ifdef HAVE_WINDOW_PREVIEWS
+static void preview_window_closed(WnckScreen* screen, WnckWindow* wnck_window,
+                                  TasklistData* tasklist) {
+  window_thumbnail_cache_remove(tasklist->thumbnail_cache,
+                                wnck_window_get_xid(wnck_window));
+}
+
 static cairo_surface_t* preview_window_thumbnail(WnckWindow* wnck_window,
                                                  TasklistData* tasklist,
                                                  int* thumbnail_width,
                                                  int* thumbnail_height,
                                                  int* thumbnail_scale) {
-  GdkWindow* window;
-  Window win;
-  cairo_surface_t* thumbnail;
-  cairo_t* cr;
-  double ratio;
-  int width, height, scale;
-
-  win = wnck_window_get_xid(wnck_window);
-
-  if ((window = gdk_x11_window_foreign_new_for_display(
-           gdk_display_get_default(), win)) == NULL) {
-    return NULL;
-  }
-
-  *thumbnail_scale = scale = gdk_window_get_scale_factor(window);
-  width = gdk_window_get_width(window) * scale;
-  height = gdk_window_get_height(window) * scale;
-
-  /* Scale to configured size while maintaining aspect ratio */
-  if (width > height) {
-    int max_size = MIN(width, tasklist->thumbnail_size * scale);
-    ratio = (double)max_size / (double)width;
-    *thumbnail_width = max_size;
-    *thumbnail_height = (int)((double)height * ratio);
-  } else {
-    int max_size = MIN(height, tasklist->thumbnail_size * scale);
-    ratio = (double)max_size / (double)height;
-    *thumbnail_height = max_size;
-    *thumbnail_width = (int)((double)width * ratio);
-  }
-
-  gdk_x11_display_error_trap_push(gdk_window_get_display(window));
-
-  thumbnail = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, *thumbnail_width,
-                                         *thumbnail_height);
-  cairo_surface_set_device_scale(thumbnail, scale, scale);
-  cr = cairo_create(thumbnail);
-  cairo_scale(cr, ratio, ratio);
-  gdk_cairo_set_source_window(cr, window, 0, 0);
-  cairo_paint(cr);
-  cairo_destroy(cr);
-
-  if (gdk_x11_display_error_trap_pop(gdk_window_get_display(window))) {
-    cairo_surface_destroy(thumbnail);
-    thumbnail = NULL;
+  if (tasklist->thumbnail_cache == NULL) {
+    tasklist->thumbnail_cache =
+        window_thumbnail_cache_new(gdk_display_get_default());
+    g_signal_connect(wnck_screen_get_default(), "window-closed",
+                     G_CALLBACK(preview_window_closed), tasklist);
   }
 
-  g_object_unref(window);
-
-  return thumbnail;
+  return window_thumbnail_cache_get(
+      tasklist->thumbnail_cache, wnck_window_get_xid(wnck_window),
+      tasklist->thumbnail_size, thumbnail_width, thumbnail_height,
+      thumbnail_scale);
 }
 
 #define PREVIEW_PADDING 5
@@ -1101,6 +1070,13 @@ static void destroy_tasklist(GtkWidget* widget, TasklistData* tasklist) {
 
 #ifdef HAVE_WINDOW_PREVIEWS
   if (tasklist->preview) gtk_widget_destroy(tasklist->preview);
+
+#ifdef HAVE_X11
+  if (tasklist->thumbnail_cache) {
+    g_signal_handlers_disconnect_by_data(wnck_screen_get_default(), tasklist);
+    window_thumbnail_cache_free(tasklist->thumbnail_cache);
+  }
+#endif /* HAVE_X11 */
 #endif
 
   g_free(tasklist);
@@ -0,0 +1,304 @@
+/*
+ * window-thumbnail-cache.c: thumbnails of the window-list previews
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "window-thumbnail-cache.h"
+
+#ifdef HAVE_X11
+
+#ifdef HAVE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif /* HAVE_XDAMAGE */
+
+/* Reading the contents of a window is a full-size transfer from the X
+ * server, while the pointer moving along the tasklist asks for the same
+ * few thumbnails over and over. Each window keeps its scaled down contents
+ * until a Damage event says that it was drawn to, and the surface is
+ * reused when it is scaled again at the same size. Without the Damage
+ * extension the contents are read every time, as there is no way to tell
+ * that they are still current. */
+
+#define WINDOW_THUMBNAIL_CACHE_MAX_ENTRIES 32
+
+typedef struct {
+  GList link;
+
+  Window xid;
+  int size;
+
+  cairo_surface_t* surface;
+  int width;
+  int height;
+  int scale;
+
+  gboolean dirty;
+#ifdef HAVE_XDAMAGE
+  Damage damage;
+#endif /* HAVE_XDAMAGE */
+} WindowThumbnail;
+
+struct _WindowThumbnailCache {
+  GdkDisplay* display;
+
+  GHashTable* thumbnails;
+  /* most recently used first */
+  GQueue lru;
+
+  gboolean have_damage;
+  int damage_event_base;
+};
+
+static void window_thumbnail_free(WindowThumbnailCache* cache,
+                                  WindowThumbnail* thumbnail) {
+  g_queue_unlink(&cache->lru, &thumbnail->link);
+
+#ifdef HAVE_XDAMAGE
+  /* the damage is gone already if the window was destroyed */
+  if (thumbnail->damage) {
+    gdk_x11_display_error_trap_push(cache->display);
+    XDamageDestroy(GDK_DISPLAY_XDISPLAY(cache->display), thumbnail->damage);
+    gdk_x11_display_error_trap_pop_ignored(cache->display);
+  }
+#endif /* HAVE_XDAMAGE */
+
+  if (thumbnail->surface) cairo_surface_destroy(thumbnail->surface);
+
+  g_slice_free(WindowThumbnail, thumbnail);
+}
+
+#ifdef HAVE_XDAMAGE
+static GdkFilterReturn window_thumbnail_cache_filter(GdkXEvent* gdk_xevent,
+                                                     GdkEvent* event,
+                                                     gpointer data) {
+  WindowThumbnailCache* cache = data;
+  XEvent* xevent = gdk_xevent;
+  XDamageNotifyEvent* damage_event;
+  WindowThumbnail* thumbnail;
+
+  if (xevent->type != cache->damage_event_base + XDamageNotify)
+    return GDK_FILTER_CONTINUE;
+
+  damage_event = (XDamageNotifyEvent*)xevent;
+  thumbnail = g_hash_table_lookup(cache->thumbnails,
+                                  GSIZE_TO_POINTER(damage_event->drawable));
+
+  if (thumbnail && thumbnail->damage == damage_event->damage)
+    thumbnail->dirty = TRUE;
+
+  return GDK_FILTER_CONTINUE;
+}
+#endif /* HAVE_XDAMAGE */
+
+WindowThumbnailCache* window_thumbnail_cache_new(GdkDisplay* display) {
+  WindowThumbnailCache* cache;
+
+  g_return_val_if_fail(GDK_IS_X11_DISPLAY(display), NULL);
+
+  cache = g_new0(WindowThumbnailCache, 1);
+  cache->display = g_object_ref(display);
+  cache->thumbnails = g_hash_table_new(g_direct_hash, g_direct_equal);
+  g_queue_init(&cache->lru);
+
+#ifdef HAVE_XDAMAGE
+  {
+    int error_base;
+
+    cache->have_damage =
+        XDamageQueryExtension(GDK_DISPLAY_XDISPLAY(display),
+                              &cache->damage_event_base, &error_base);
+  }
+
+  if (cache->have_damage)
+    gdk_window_add_filter(NULL, window_thumbnail_cache_filter, cache);
+#endif /* HAVE_XDAMAGE */
+
+  return cache;
+}
+
+void window_thumbnail_cache_free(WindowThumbnailCache* cache) {
+  GHashTableIter iter;
+  gpointer value;
+
+  if (!cache) return;
+
+#ifdef HAVE_XDAMAGE
+  if (cache->have_damage)
+    gdk_window_remove_filter(NULL, window_thumbnail_cache_filter, cache);
+#endif /* HAVE_XDAMAGE */
+
+  g_hash_table_iter_init(&iter, cache->thumbnails);
+  while (g_hash_table_iter_next(&iter, NULL, &value))
+    window_thumbnail_free(cache, value);
+  g_hash_table_destroy(cache->thumbnails);
+
+  g_object_unref(cache->display);
+  g_free(cache);
+}
+
+static WindowThumbnail* window_thumbnail_new(WindowThumbnailCache* cache,
+                                             Window xid) {
+  WindowThumbnail* thumbnail;
+
+  thumbnail = g_slice_new0(WindowThumbnail);
+  thumbnail->link.data = thumbnail;
+  thumbnail->xid = xid;
+  thumbnail->dirty = TRUE;
+
+#ifdef HAVE_XDAMAGE
+  /* a single event when the window is first drawn to after a refresh */
+  if (cache->have_damage) {
+    gdk_x11_display_error_trap_push(cache->display);
+    thumbnail->damage = XDamageCreate(GDK_DISPLAY_XDISPLAY(cache->display),
+                                      xid, XDamageReportNonEmpty);
+    gdk_x11_display_error_trap_pop_ignored(cache->display);
+  }
+#endif /* HAVE_XDAMAGE */
+
+  return thumbnail;
+}
+
+/* Scales the current contents of the window down to the thumbnail size,
+ * into the surface of the previous refresh when the size did not change */
+static gboolean window_thumbnail_refresh(WindowThumbnailCache* cache,
+                                         WindowThumbnail* thumbnail) {
+  GdkWindow* window;
+  cairo_t* cr;
+  double ratio;
+  int width, height, scale;
+  int thumbnail_width, thumbnail_height;
+  gboolean failed;
+
+  window = gdk_x11_window_foreign_new_for_display(cache->display,
+                                                  thumbnail->xid);
+  if (window == NULL) return FALSE;
+
+  scale = gdk_window_get_scale_factor(window);
+  width = gdk_window_get_width(window) * scale;
+  height = gdk_window_get_height(window) * scale;
+
+  /* Scale to configured size while maintaining aspect ratio */
+  if (width > height) {
+    int max_size = MIN(width, thumbnail->size * scale);
+    ratio = (double)max_size / (double)width;
+    thumbnail_width = max_size;
+    thumbnail_height = (int)((double)height * ratio);
+  } else {
+    int max_size = MIN(height, thumbnail->size * scale);
+    ratio = (double)max_size / (double)height;
+    thumbnail_height = max_size;
+    thumbnail_width = (int)((double)width * ratio);
+  }
+
+  if (!thumbnail->surface || thumbnail->width != thumbnail_width ||
+      thumbnail->height != thumbnail_height || thumbnail->scale != scale) {
+    if (thumbnail->surface) cairo_surface_destroy(thumbnail->surface);
+
+    thumbnail->surface = cairo_image_surface_create(
+        CAIRO_FORMAT_ARGB32, thumbnail_width, thumbnail_height);
+    cairo_surface_set_device_scale(thumbnail->surface, scale, scale);
+    thumbnail->width = thumbnail_width;
+    thumbnail->height = thumbnail_height;
+    thumbnail->scale = scale;
+  }
+
+  gdk_x11_display_error_trap_push(cache->display);
+
+#ifdef HAVE_XDAMAGE
+  /* from now on, drawing to the window makes the thumbnail dirty again */
+  if (thumbnail->damage)
+    XDamageSubtract(GDK_DISPLAY_XDISPLAY(cache->display), thumbnail->damage,
+                    None, None);
+#endif /* HAVE_XDAMAGE */
+
+  cr = cairo_create(thumbnail->surface);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+  cairo_scale(cr, ratio, ratio);
+  gdk_cairo_set_source_window(cr, window, 0, 0);
+  cairo_paint(cr);
+  cairo_destroy(cr);
+
+  failed = gdk_x11_display_error_trap_pop(cache->display) != 0;
+
+  g_object_unref(window);
+
+  thumbnail->dirty = failed || !cache->have_damage;
+
+  return !failed;
+}
+
+/* Returns a new reference to the thumbnail of the window, @size pixels
+ * wide or high, or NULL if the window cannot be read */
+cairo_surface_t* window_thumbnail_cache_get(WindowThumbnailCache* cache,
+                                            Window xid, int size, int* width,
+                                            int* height, int* scale) {
+  WindowThumbnail* thumbnail;
+
+  g_return_val_if_fail(cache != NULL, NULL);
+
+  thumbnail = g_hash_table_lookup(cache->thumbnails, GSIZE_TO_POINTER(xid));
+  if (thumbnail) {
+    g_queue_unlink(&cache->lru, &thumbnail->link);
+  } else {
+    while (g_queue_get_length(&cache->lru) >=
+           WINDOW_THUMBNAIL_CACHE_MAX_ENTRIES) {
+      WindowThumbnail* last = g_queue_peek_tail(&cache->lru);
+
+      g_hash_table_remove(cache->thumbnails, GSIZE_TO_POINTER(last->xid));
+      window_thumbnail_free(cache, last);
+    }
+
+    thumbnail = window_thumbnail_new(cache, xid);
+    g_hash_table_insert(cache->thumbnails, GSIZE_TO_POINTER(xid), thumbnail);
+  }
+
+  g_queue_push_head_link(&cache->lru, &thumbnail->link);
+
+  if (thumbnail->size != size) {
+    thumbnail->size = size;
+    thumbnail->dirty = TRUE;
+  }
+
+  if (thumbnail->dirty && !window_thumbnail_refresh(cache, thumbnail))
+    return NULL;
+
+  *width = thumbnail->width;
+  *height = thumbnail->height;
+  *scale = thumbnail->scale;
+
+  return cairo_surface_reference(thumbnail->surface);
+}
+
+void window_thumbnail_cache_remove(WindowThumbnailCache* cache, Window xid) {
+  WindowThumbnail* thumbnail;
+
+  g_return_if_fail(cache != NULL);
+
+  thumbnail = g_hash_table_lookup(cache->thumbnails, GSIZE_TO_POINTER(xid));
+  if (!thumbnail) return;
+
+  g_hash_table_remove(cache->thumbnails, GSIZE_TO_POINTER(xid));
+  window_thumbnail_free(cache, thumbnail);
+}
+
+#endif /* HAVE_X11 */
@@ -0,0 +1,48 @@
+/*
+ * window-thumbnail-cache.h: thumbnails of the window-list previews
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __WINDOW_THUMBNAIL_CACHE_H__
+#define __WINDOW_THUMBNAIL_CACHE_H__
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#ifdef HAVE_X11
+#include <gdk/gdkx.h>
+#endif /* HAVE_X11 */
+
+G_BEGIN_DECLS
+
+typedef struct _WindowThumbnailCache WindowThumbnailCache;
+
+#ifdef HAVE_X11
+WindowThumbnailCache* window_thumbnail_cache_new(GdkDisplay* display);
+void window_thumbnail_cache_free(WindowThumbnailCache* cache);
+
+cairo_surface_t* window_thumbnail_cache_get(WindowThumbnailCache* cache,
+                                            Window xid, int size, int* width,
+                                            int* height, int* scale);
+void window_thumbnail_cache_remove(WindowThumbnailCache* cache, Window xid);
+#endif /* HAVE_X11 */
+
+G_END_DECLS
+
+#endif /* __WINDOW_THUMBNAIL_CACHE_H__ */
@@ -72,6 +72,11 @@ typedef struct {
   MatePanelAppletOrient orient;
   guint size;
   char *background;
+  /* the panel pixmap of the last "pixmap:" background, reused as long as
+   * the panel sends the same XID and generation */
+  cairo_surface_t *background_surface;
+  gulong background_xid;
+  guint background_generation;
 
   int previous_width;
   int previous_height;
@@ -83,6 +88,12 @@ typedef struct {
 
   gboolean locked;
   gboolean locked_down;
+
+  /* while a Configure call is applied, the changes of the flags and size
+   * hints are only recorded, and announced to the panel once at the end */
+  gboolean configuring;
+  gboolean flags_changed;
+  gboolean size_hints_changed;
 } MatePanelAppletPrivate;
 
 enum {
@@ -112,6 +123,8 @@ enum {
 };
 
 static void mate_panel_applet_handle_background(MatePanelApplet *applet);
+static void mate_panel_applet_clear_background_surface(MatePanelApplet *applet);
+static void mate_panel_applet_emit_properties_changed(MatePanelApplet *applet);
 static GtkAction *mate_panel_applet_menu_get_action(MatePanelApplet *applet,
                                                     const gchar *action);
 static void mate_panel_applet_menu_update_actions(MatePanelApplet *applet);
@@ -204,31 +217,8 @@ void mate_panel_applet_set_flags(MatePanelApplet *applet,
 
   g_object_notify(G_OBJECT(applet), "flags");
 
-  if (priv->connection) {
-    GVariantBuilder builder;
-    GVariantBuilder invalidated_builder;
-    GError *error = NULL;
-
-    g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
-    g_variant_builder_init(&invalidated_builder, G_VARIANT_TYPE("as"));
-
-    g_variant_builder_add(&builder, "{sv}", "Flags",
-                          g_variant_new_uint32(priv->flags));
-
-    g_dbus_connection_emit_signal(
-        priv->connection, NULL, priv->object_path,
-        "org.freedesktop.DBus.Properties", "PropertiesChanged",
-        g_variant_new("(sa{sv}as)", MATE_PANEL_APPLET_INTERFACE, &builder,
-                      &invalidated_builder),
-        &error);
-    if (error) {
-      g_printerr("Failed to send signal PropertiesChanged::Flags: %s\n",
-                 error->message);
-      g_error_free(error);
-    }
-    g_variant_builder_clear(&builder);
-    g_variant_builder_clear(&invalidated_builder);
-  }
+  priv->flags_changed = TRUE;
+  mate_panel_applet_emit_properties_changed(applet);
 }
 
 static void mate_panel_applet_size_hints_ensure(MatePanelApplet *applet,
@@ -291,37 +281,8 @@ void mate_panel_applet_set_size_hints(MatePanelApplet *applet,
 
   g_object_notify(G_OBJECT(applet), "size-hints");
 
-  if (priv->connection) {
-    GVariantBuilder builder;
-    GVariantBuilder invalidated_builder;
-    GVariant **children;
-    GError *error = NULL;
-
-    g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
-    g_variant_builder_init(&invalidated_builder, G_VARIANT_TYPE("as"));
-
-    children = g_new(GVariant *, priv->size_hints_len);
-    for (i = 0; i < n_elements; i++)
-      children[i] = g_variant_new_int32(priv->size_hints[i]);
-    g_variant_builder_add(&builder, "{sv}", "SizeHints",
-                          g_variant_new_array(G_VARIANT_TYPE_INT32, children,
-                                              priv->size_hints_len));
-    g_free(children);
-
-    g_dbus_connection_emit_signal(
-        priv->connection, NULL, priv->object_path,
-        "org.freedesktop.DBus.Properties", "PropertiesChanged",
-        g_variant_new("(sa{sv}as)", MATE_PANEL_APPLET_INTERFACE, &builder,
-                      &invalidated_builder),
-        &error);
-    if (error) {
-      g_printerr("Failed to send signal PropertiesChanged::SizeHints: %s\n",
-                 error->message);
-      g_error_free(error);
-    }
-    g_variant_builder_clear(&builder);
-    g_variant_builder_clear(&invalidated_builder);
-  }
+  priv->size_hints_changed = TRUE;
+  mate_panel_applet_emit_properties_changed(applet);
 }
 
 guint mate_panel_applet_get_size(MatePanelApplet *applet) {
@@ -736,6 +697,7 @@ static void mate_panel_applet_finalize(GObject *object) {
   g_clear_pointer(&priv->size_hints, g_free);
   g_clear_pointer(&priv->prefs_path, g_free);
   g_clear_pointer(&priv->background, g_free);
+  mate_panel_applet_clear_background_surface(applet);
   g_clear_pointer(&priv->id, g_free);
 
   /* closure is owned by the factory */
@@ -1115,14 +1077,43 @@ static gboolean mate_panel_applet_parse_color(const gchar *color_str,
   return gdk_rgba_parse(color, color_str);
 }
 
+static void mate_panel_applet_clear_background_surface(
+    MatePanelApplet *applet) {
+  MatePanelAppletPrivate *priv;
+
+  priv = mate_panel_applet_get_instance_private(applet);
+
+  if (!priv->background_surface) return;
+
 #ifdef HAVE_X11
+  /* the pixmap may already be gone, taking the picture cairo made for it */
+  if (GDK_IS_X11_DISPLAY(gdk_display_get_default())) {
+    GdkDisplay *display = gdk_display_get_default();
+
+    gdk_x11_display_error_trap_push(display);
+    cairo_surface_destroy(priv->background_surface);
+    gdk_x11_display_error_trap_pop_ignored(display);
+  } else
+#endif
+    cairo_surface_destroy(priv->background_surface);
+
+  priv->background_surface = NULL;
+  priv->background_xid = 0;
+  priv->background_generation = 0;
+}
+
+#ifdef HAVE_X11
+/* The generation is missing from the strings of older panels, and is then
+ * left to 0: the pixmap is not reused in that case */
 static gboolean mate_panel_applet_parse_pixmap_str(const char *str, Window *xid,
-                                                   int *x, int *y) {
+                                                   guint *generation, int *x,
+                                                   int *y) {
   char **elements;
   char *tmp;
 
   g_return_val_if_fail(str != NULL, FALSE);
   g_return_val_if_fail(xid != NULL, FALSE);
+  g_return_val_if_fail(generation != NULL, FALSE);
   g_return_val_if_fail(x != NULL, FALSE);
   g_return_val_if_fail(y != NULL, FALSE);
 
@@ -1143,6 +1134,12 @@ static gboolean mate_panel_applet_parse_pixmap_str(const char *str, Window *xid,
   *y = strtol(elements[2], &tmp, 10);
   if (tmp == elements[2]) goto ERROR_AND_FREE;
 
+  *generation = 0;
+  if (elements[3] && *elements[3]) {
+    *generation = strtoul(elements[3], &tmp, 10);
+    if (tmp == elements[3]) goto ERROR_AND_FREE;
+  }
+
   g_strfreev(elements);
   return TRUE;
 
@@ -1171,7 +1168,8 @@ static cairo_surface_t *mate_panel_applet_create_foreign_surface_for_display(
 }
 
 static cairo_pattern_t *mate_panel_applet_get_pattern_from_pixmap(
-    MatePanelApplet *applet, Window xid, int x, int y) {
+    MatePanelApplet *applet, Window xid, guint generation, int x, int y) {
+  MatePanelAppletPrivate *priv;
   cairo_surface_t *background;
   cairo_surface_t *surface;
   GdkWindow *window;
@@ -1185,17 +1183,36 @@ static cairo_pattern_t *mate_panel_applet_get_pattern_from_pixmap(
 
   if (!gtk_widget_get_realized(GTK_WIDGET(applet))) return NULL;
 
+  priv = mate_panel_applet_get_instance_private(applet);
   window = gtk_widget_get_window(GTK_WIDGET(applet));
   display = gdk_window_get_display(window);
 
-  background = mate_panel_applet_create_foreign_surface_for_display(
-      display, gdk_window_get_visual(window), xid);
+  /* Moving the applet along the panel only changes the offset: the pixmap
+   * is still the one we have, and asking the server for its geometry again
+   * would only cost a round trip. */
+  if (priv->background_surface && generation != 0 &&
+      priv->background_xid == xid &&
+      priv->background_generation == generation) {
+    background = cairo_surface_reference(priv->background_surface);
+  } else {
+    mate_panel_applet_clear_background_surface(applet);
 
-  /* background can be NULL if the user changes the background very fast.
-   * We'll get the next update, so it's not a big deal. */
-  if (!background || cairo_surface_status(background) != CAIRO_STATUS_SUCCESS) {
-    if (background) cairo_surface_destroy(background);
-    return NULL;
+    background = mate_panel_applet_create_foreign_surface_for_display(
+        display, gdk_window_get_visual(window), xid);
+
+    /* background can be NULL if the user changes the background very fast.
+     * We'll get the next update, so it's not a big deal. */
+    if (!background ||
+        cairo_surface_status(background) != CAIRO_STATUS_SUCCESS) {
+      if (background) cairo_surface_destroy(background);
+      return NULL;
+    }
+
+    if (generation != 0) {
+      priv->background_surface = cairo_surface_reference(background);
+      priv->background_xid = xid;
+      priv->background_generation = generation;
+    }
   }
 
   width = gdk_window_get_width(window);
@@ -1255,12 +1272,13 @@ static MatePanelAppletBackgroundType mate_panel_applet_handle_background_string(
 #ifdef HAVE_X11
     if (GDK_IS_X11_DISPLAY(gdk_display_get_default())) {
       Window pixmap_id;
+      guint generation;
       int x, y;
 
       g_return_val_if_fail(pattern != NULL, PANEL_NO_BACKGROUND);
 
-      if (!mate_panel_applet_parse_pixmap_str(elements[1], &pixmap_id, &x,
-                                              &y)) {
+      if (!mate_panel_applet_parse_pixmap_str(elements[1], &pixmap_id,
+                                              &generation, &x, &y)) {
         g_warning("Incomplete '%s' background type received: %s", elements[0],
                   elements[1]);
 
@@ -1268,8 +1286,8 @@ static MatePanelAppletBackgroundType mate_panel_applet_handle_background_string(
         return PANEL_NO_BACKGROUND;
       }
 
-      *pattern =
-          mate_panel_applet_get_pattern_from_pixmap(applet, pixmap_id, x, y);
+      *pattern = mate_panel_applet_get_pattern_from_pixmap(
+          applet, pixmap_id, generation, x, y);
       if (!*pattern) {
         g_warning("Failed to get pattern %s", elements[1]);
         g_strfreev(elements);
@@ -1315,6 +1333,10 @@ static void mate_panel_applet_set_background_string(MatePanelApplet *applet,
 
   g_free(priv->background);
   priv->background = background ? g_strdup(background) : NULL;
+
+  if (!priv->background || !g_str_has_prefix(priv->background, "pixmap:"))
+    mate_panel_applet_clear_background_surface(applet);
+
   mate_panel_applet_handle_background(applet);
 
   g_object_notify(G_OBJECT(applet), "background");
@@ -1885,37 +1907,12 @@ static GdkEvent *button_press_event_new(MatePanelApplet *applet, guint button,
   return event;
 }
 
-static void method_call_cb(GDBusConnection *connection, const gchar *sender,
-                           const gchar *object_path,
-                           const gchar *interface_name,
-                           const gchar *method_name, GVariant *parameters,
-                           GDBusMethodInvocation *invocation,
-                           gpointer user_data) {
-  MatePanelApplet *applet = MATE_PANEL_APPLET(user_data);
-
-  if (g_strcmp0(method_name, "PopupMenu") == 0) {
-    guint button;
-    guint time;
-
-    g_variant_get(parameters, "(uu)", &button, &time);
-
-    GdkEvent *event = button_press_event_new(applet, button, time);
-    mate_panel_applet_menu_popup(applet, event);
-    gdk_event_free(event);
-
-    g_dbus_method_invocation_return_value(invocation, NULL);
-  }
-}
-
-static GVariant *get_property_cb(GDBusConnection *connection,
-                                 const gchar *sender, const gchar *object_path,
-                                 const gchar *interface_name,
-                                 const gchar *property_name, GError **error,
-                                 gpointer user_data) {
+static GVariant *mate_panel_applet_get_dbus_property(
+    MatePanelApplet *applet, const gchar *property_name) {
   MatePanelAppletPrivate *priv;
   GVariant *retval = NULL;
 
-  priv = mate_panel_applet_get_instance_private(MATE_PANEL_APPLET(user_data));
+  priv = mate_panel_applet_get_instance_private(applet);
 
   if (g_strcmp0(property_name, "PrefsPath") == 0) {
     retval = g_variant_new_string(priv->prefs_path ? priv->prefs_path : "");
@@ -1946,13 +1943,9 @@ static GVariant *get_property_cb(GDBusConnection *connection,
   return retval;
 }
 
-static gboolean set_property_cb(GDBusConnection *connection,
-                                const gchar *sender, const gchar *object_path,
-                                const gchar *interface_name,
-                                const gchar *property_name, GVariant *value,
-                                GError **error, gpointer user_data) {
-  MatePanelApplet *applet = MATE_PANEL_APPLET(user_data);
-
+static void mate_panel_applet_set_dbus_property(MatePanelApplet *applet,
+                                                const gchar *property_name,
+                                                GVariant *value) {
   if (g_strcmp0(property_name, "PrefsPath") == 0) {
     mate_panel_applet_set_preferences_path(applet,
                                            g_variant_get_string(value, NULL));
@@ -1976,10 +1969,155 @@ static gboolean set_property_cb(GDBusConnection *connection,
   } else if (g_strcmp0(property_name, "LockedDown") == 0) {
     mate_panel_applet_set_locked_down(applet, g_variant_get_boolean(value));
   }
+}
+
+/* Announces the flags and size hints changed since the last call to the
+ * panel, in a single PropertiesChanged signal */
+static void mate_panel_applet_emit_properties_changed(MatePanelApplet *applet) {
+  MatePanelAppletPrivate *priv;
+  GVariantBuilder builder;
+  GVariantBuilder invalidated_builder;
+  GError *error = NULL;
+
+  priv = mate_panel_applet_get_instance_private(applet);
+
+  if (priv->configuring) return;
+
+  if (!priv->connection || (!priv->flags_changed && !priv->size_hints_changed))
+    goto out;
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
+  g_variant_builder_init(&invalidated_builder, G_VARIANT_TYPE("as"));
+
+  /* flags first: the panel adds the size of the handle to the size hints */
+  if (priv->flags_changed)
+    g_variant_builder_add(&builder, "{sv}", "Flags",
+                          mate_panel_applet_get_dbus_property(applet, "Flags"));
+  if (priv->size_hints_changed)
+    g_variant_builder_add(
+        &builder, "{sv}", "SizeHints",
+        mate_panel_applet_get_dbus_property(applet, "SizeHints"));
+
+  g_dbus_connection_emit_signal(
+      priv->connection, NULL, priv->object_path,
+      "org.freedesktop.DBus.Properties", "PropertiesChanged",
+      g_variant_new("(sa{sv}as)", MATE_PANEL_APPLET_INTERFACE, &builder,
+                    &invalidated_builder),
+      &error);
+  if (error) {
+    g_printerr("Failed to send signal PropertiesChanged: %s\n", error->message);
+    g_error_free(error);
+  }
+  g_variant_builder_clear(&builder);
+  g_variant_builder_clear(&invalidated_builder);
+
+out:
+  priv->flags_changed = FALSE;
+  priv->size_hints_changed = FALSE;
+}
+
+/* Applies all the properties of a Configure call at once: the new size and
+ * orientation are both stored before any of them is signalled, so that the
+ * applet never lays itself out for half of the change, and the flags and
+ * size hints it sets in response go back to the panel in one signal. */
+static void mate_panel_applet_configure(MatePanelApplet *applet,
+                                        GVariant *properties) {
+  MatePanelAppletPrivate *priv;
+  MatePanelAppletOrient old_orient;
+  guint old_size;
+  guint orient;
+  GVariantIter iter;
+  const gchar *property_name;
+  GVariant *value;
+
+  priv = mate_panel_applet_get_instance_private(applet);
+
+  priv->configuring = TRUE;
+  g_object_freeze_notify(G_OBJECT(applet));
+
+  old_orient = priv->orient;
+  old_size = priv->size;
+
+  if (g_variant_lookup(properties, "Orient", "u", &orient))
+    priv->orient = orient;
+  g_variant_lookup(properties, "Size", "u", &priv->size);
+
+  if (priv->orient != old_orient) {
+    g_signal_emit(G_OBJECT(applet), mate_panel_applet_signals[CHANGE_ORIENT],
+                  0, priv->orient);
+    g_object_notify(G_OBJECT(applet), "orient");
+  }
+
+  if (priv->size != old_size) {
+    g_signal_emit(G_OBJECT(applet), mate_panel_applet_signals[CHANGE_SIZE], 0,
+                  priv->size);
+    g_object_notify(G_OBJECT(applet), "size");
+  }
+
+  g_variant_iter_init(&iter, properties);
+  while (g_variant_iter_next(&iter, "{&sv}", &property_name, &value)) {
+    if (g_strcmp0(property_name, "Orient") != 0 &&
+        g_strcmp0(property_name, "Size") != 0)
+      mate_panel_applet_set_dbus_property(applet, property_name, value);
+    g_variant_unref(value);
+  }
+
+  g_object_thaw_notify(G_OBJECT(applet));
+  priv->configuring = FALSE;
+
+  mate_panel_applet_emit_properties_changed(applet);
+}
+
+static GVariant *get_property_cb(GDBusConnection *connection,
+                                 const gchar *sender, const gchar *object_path,
+                                 const gchar *interface_name,
+                                 const gchar *property_name, GError **error,
+                                 gpointer user_data) {
+  return mate_panel_applet_get_dbus_property(MATE_PANEL_APPLET(user_data),
+                                             property_name);
+}
+
+static gboolean set_property_cb(GDBusConnection *connection,
+                                const gchar *sender, const gchar *object_path,
+                                const gchar *interface_name,
+                                const gchar *property_name, GVariant *value,
+                                GError **error, gpointer user_data) {
+  mate_panel_applet_set_dbus_property(MATE_PANEL_APPLET(user_data),
+                                      property_name, value);
 
   return TRUE;
 }
 
+static void method_call_cb(GDBusConnection *connection, const gchar *sender,
+                           const gchar *object_path,
+                           const gchar *interface_name,
+                           const gchar *method_name, GVariant *parameters,
+                           GDBusMethodInvocation *invocation,
+                           gpointer user_data) {
+  MatePanelApplet *applet = MATE_PANEL_APPLET(user_data);
+
+  if (g_strcmp0(method_name, "PopupMenu") == 0) {
+    guint button;
+    guint time;
+
+    g_variant_get(parameters, "(uu)", &button, &time);
+
+    GdkEvent *event = button_press_event_new(applet, button, time);
+    mate_panel_applet_menu_popup(applet, event);
+    gdk_event_free(event);
+
+    g_dbus_method_invocation_return_value(invocation, NULL);
+  } else if (g_strcmp0(method_name, "Configure") == 0) {
+    GVariant *properties;
+
+    g_variant_get(parameters, "(@a{sv})", &properties);
+    mate_panel_applet_configure(applet, properties);
+    g_variant_unref(properties);
+
+    g_dbus_method_invocation_return_value(invocation, NULL);
+  }
+}
+
 static const gchar introspection_xml[] =
     "<node>"
     "<interface name='org.mate.panel.applet.Applet'>"
@@ -1987,6 +2125,9 @@ static const gchar introspection_xml[] =
     "<arg name='button' type='u' direction='in'/>"
     "<arg name='time' type='u' direction='in'/>"
     "</method>"
+    "<method name='Configure'>"
+    "<arg name='properties' type='a{sv}' direction='in'/>"
+    "</method>"
     "<property name='PrefsPath' type='s' access='readwrite'/>"
     "<property name='Orient' type='u' access='readwrite' />"
     "<property name='Size' type='u' access='readwrite'/>"
@@ -15,6 +15,7 @@
 #include <glib/gi18n.h>
 #include <libpanel-util/panel-gtk.h>
 #include <libpanel-util/panel-show.h>
+#include <libpanel-util/panel-trace.h>
 #include <signal.h>
 #include <string.h>
 #include <unistd.h>
@@ -38,6 +39,9 @@
 #include "panel-util.h"
 
 static GSList *registered_applets = NULL;
+/* indexes of registered_applets */
+static GHashTable *applets_by_id = NULL;
+static GHashTable *applets_by_widget = NULL;
 static GSList *queued_position_saves = NULL;
 static guint queued_position_source = 0;
 
@@ -45,6 +49,7 @@ static GtkCheckMenuItem *checkbox_id = NULL;
 
 static void applet_menu_show(GtkWidget *w, AppletInfo *info);
 static void applet_menu_deactivate(GtkWidget *w, AppletInfo *info);
+static void mate_panel_applet_update_placement(AppletInfo *info);
 
 static inline PanelWidget *mate_panel_applet_get_panel_widget(
     AppletInfo *info) {
@@ -623,6 +628,12 @@ static void mate_panel_applet_destroy(GtkWidget *widget, AppletInfo *info) {
   g_return_if_fail(info != NULL);
 
   g_signal_handlers_disconnect_by_data(info->settings, widget);
+  g_signal_handlers_disconnect_by_data(info->settings, info);
+
+  if (g_hash_table_lookup(applets_by_widget, widget) == info)
+    g_hash_table_remove(applets_by_widget, widget);
+  if (g_hash_table_lookup(applets_by_id, info->id) == info)
+    g_hash_table_remove(applets_by_id, info->id);
 
   info->widget = NULL;
 
@@ -680,10 +691,14 @@ typedef struct {
   guint locked : 1;
 } MatePanelAppletToLoad;
 
-/* Each time those lists get both empty,
+/* Each time both the queue and the loading table get empty,
  * mate_panel_applet_queue_initial_unhide_toplevels() should be called */
 static GSList *mate_panel_applets_to_load = NULL;
-static GSList *mate_panel_applets_loading = NULL;
+/* id -> MatePanelAppletToLoad, for the objects whose loading started */
+static GHashTable *mate_panel_applets_loading = NULL;
+/* toplevel id -> number of its objects queued or loading; a toplevel is
+ * unhidden as soon as this drops to zero */
+static GHashTable *mate_panel_applets_pending = NULL;
 /* We have a timeout to always unhide toplevels after a delay, in case of some
  * blocking applet */
 #define UNHIDE_TOPLEVELS_TIMEOUT_SECONDS 5
@@ -697,22 +712,26 @@ static void free_applet_to_load(MatePanelAppletToLoad *applet) {
   g_free(applet);
 }
 
+static gboolean mate_panel_applet_is_loading(void) {
+  return mate_panel_applets_to_load != NULL ||
+         (mate_panel_applets_loading &&
+          g_hash_table_size(mate_panel_applets_loading) > 0);
+}
+
 gboolean mate_panel_applet_on_load_queue(const char *id) {
   GSList *li;
   for (li = mate_panel_applets_to_load; li != NULL; li = li->next) {
     MatePanelAppletToLoad *applet = li->data;
     if (strcmp(applet->id, id) == 0) return TRUE;
   }
-  for (li = mate_panel_applets_loading; li != NULL; li = li->next) {
-    MatePanelAppletToLoad *applet = li->data;
-    if (strcmp(applet->id, id) == 0) return TRUE;
-  }
-  return FALSE;
+  return mate_panel_applets_loading &&
+         g_hash_table_contains(mate_panel_applets_loading, id);
 }
 
 /* This doesn't do anything if the initial unhide already happened */
 static gboolean mate_panel_applet_queue_initial_unhide_toplevels(
     gpointer user_data) {
+  static gboolean traced = FALSE;
   GSList *l;
 
   if (mate_panel_applet_unhide_toplevels_timeout != 0) {
@@ -723,71 +742,93 @@ static gboolean mate_panel_applet_queue_initial_unhide_toplevels(
   for (l = panel_toplevel_list_toplevels(); l != NULL; l = l->next)
     panel_toplevel_queue_initial_unhide((PanelToplevel *)l->data);
 
+  /* startup is over: save the timeline now rather than on exit, which
+   * might never cleanly happen */
+  if (!traced && panel_trace_is_enabled()) {
+    traced = TRUE;
+    panel_trace_instant("initial-unhide", NULL);
+    panel_trace_write();
+  }
+
   return FALSE;
 }
 
-void mate_panel_applet_stop_loading(const char *id) {
-  MatePanelAppletToLoad *applet;
-  GSList *l;
+static void mate_panel_applet_pending_ref(const char *toplevel_id) {
+  guint count;
 
-  for (l = mate_panel_applets_loading; l; l = l->next) {
-    applet = l->data;
+  if (!mate_panel_applets_pending)
+    mate_panel_applets_pending =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
-    if (strcmp(applet->id, id) == 0) break;
+  count = GPOINTER_TO_UINT(
+      g_hash_table_lookup(mate_panel_applets_pending, toplevel_id));
+  g_hash_table_replace(mate_panel_applets_pending, g_strdup(toplevel_id),
+                       GUINT_TO_POINTER(count + 1));
+}
+
+static void mate_panel_applet_pending_unref(const char *toplevel_id) {
+  PanelToplevel *toplevel;
+  guint count;
+
+  count = GPOINTER_TO_UINT(
+      g_hash_table_lookup(mate_panel_applets_pending, toplevel_id));
+  if (count > 1) {
+    g_hash_table_replace(mate_panel_applets_pending, g_strdup(toplevel_id),
+                         GUINT_TO_POINTER(count - 1));
+    return;
   }
 
+  g_hash_table_remove(mate_panel_applets_pending, toplevel_id);
+
+  /* everything on this toplevel is there: no need to wait for the
+   * other ones */
+  toplevel = panel_profile_get_toplevel_by_id(toplevel_id);
+  if (toplevel) {
+    panel_trace_instant("toplevel-unhide", toplevel_id);
+    panel_toplevel_queue_initial_unhide(toplevel);
+  }
+}
+
+void mate_panel_applet_stop_loading(const char *id) {
+  MatePanelAppletToLoad *applet;
+
+  applet = mate_panel_applets_loading
+               ? g_hash_table_lookup(mate_panel_applets_loading, id)
+               : NULL;
+
   /* this can happen if we reload an applet after it crashed,
    * for example */
-  if (l != NULL) {
-    mate_panel_applets_loading =
-        g_slist_delete_link(mate_panel_applets_loading, l);
+  if (applet != NULL) {
+    panel_trace_async_end("load-object", id);
+    g_hash_table_steal(mate_panel_applets_loading, id);
+    mate_panel_applet_pending_unref(applet->toplevel_id);
     free_applet_to_load(applet);
   }
 
-  if (mate_panel_applets_loading == NULL && mate_panel_applets_to_load == NULL)
+  if (!mate_panel_applet_is_loading())
     mate_panel_applet_queue_initial_unhide_toplevels(NULL);
 }
 
-static gboolean mate_panel_applet_load_idle_handler(gpointer dummy) {
+static void mate_panel_applet_load_queued(MatePanelAppletToLoad *applet) {
   PanelObjectType applet_type;
-  MatePanelAppletToLoad *applet = NULL;
-  PanelToplevel *toplevel = NULL;
+  PanelToplevel *toplevel;
   PanelWidget *panel_widget;
-  GSList *l;
 
-  if (!mate_panel_applets_to_load) {
-    mate_panel_applet_have_load_idle = FALSE;
-    return FALSE;
-  }
+  /* the key belongs to the value, which is freed when stealing it in
+   * mate_panel_applet_stop_loading() */
+  if (!mate_panel_applets_loading)
+    mate_panel_applets_loading = g_hash_table_new(g_str_hash, g_str_equal);
 
-  for (l = mate_panel_applets_to_load; l; l = l->next) {
-    applet = l->data;
-
-    toplevel = panel_profile_get_toplevel_by_id(applet->toplevel_id);
-    if (toplevel) break;
-  }
+  g_hash_table_replace(mate_panel_applets_loading, applet->id, applet);
+  panel_trace_async_begin("load-object", applet->id);
 
-  if (!l) {
-    /* All the remaining applets don't have a panel */
-    for (l = mate_panel_applets_to_load; l; l = l->next)
-      free_applet_to_load(l->data);
-    g_slist_free(mate_panel_applets_to_load);
-    mate_panel_applets_to_load = NULL;
-    mate_panel_applet_have_load_idle = FALSE;
-
-    if (mate_panel_applets_loading == NULL) {
-      /* unhide any potential initially hidden toplevel */
-      mate_panel_applet_queue_initial_unhide_toplevels(NULL);
-    }
-
-    return FALSE;
+  toplevel = panel_profile_get_toplevel_by_id(applet->toplevel_id);
+  if (!toplevel) {
+    /* The applet doesn't have a panel */
+    mate_panel_applet_stop_loading(applet->id);
+    return;
   }
 
-  mate_panel_applets_to_load =
-      g_slist_delete_link(mate_panel_applets_to_load, l);
-  mate_panel_applets_loading =
-      g_slist_append(mate_panel_applets_loading, applet);
-
   panel_widget = panel_toplevel_get_panel_widget(toplevel);
 
   if (applet->edge_relativity == PANEL_EDGE_CENTER ||
@@ -846,8 +887,73 @@ static gboolean mate_panel_applet_load_idle_handler(gpointer dummy) {
   /* Only the real applets will do a late stop_loading */
   if (applet_type != PANEL_OBJECT_APPLET)
     mate_panel_applet_stop_loading(applet->id);
+}
 
-  return TRUE;
+static gboolean mate_panel_applet_has_toplevel(MatePanelAppletToLoad *applet) {
+  return panel_profile_get_toplevel_by_id(applet->toplevel_id) != NULL;
+}
+
+static gboolean mate_panel_applet_load_idle_handler(gpointer dummy) {
+  MatePanelAppletToLoad *applet;
+  gboolean loaded = FALSE;
+  GSList *l;
+  GSList *next;
+
+  /* Out-of-process applets only start an asynchronous D-Bus activation
+   * here: start all of them at once so that their factories come up
+   * concurrently. Each frame is put at its position on its panel when
+   * the reply arrives, see _mate_panel_applet_frame_activated().
+   * The objects on a drawer stay queued until the drawer is loaded. */
+  for (l = mate_panel_applets_to_load; l; l = next) {
+    next = l->next;
+    applet = l->data;
+
+    if (applet->type != PANEL_OBJECT_APPLET ||
+        !mate_panel_applet_has_toplevel(applet))
+      continue;
+
+    mate_panel_applets_to_load =
+        g_slist_delete_link(mate_panel_applets_to_load, l);
+    mate_panel_applet_load_queued(applet);
+    loaded = TRUE;
+  }
+
+  /* The other objects are built in the panel process: one per idle
+   * callback, so that the D-Bus replies get processed in between. */
+  for (l = mate_panel_applets_to_load; l; l = l->next) {
+    applet = l->data;
+
+    if (!mate_panel_applet_has_toplevel(applet)) continue;
+
+    mate_panel_applets_to_load =
+        g_slist_delete_link(mate_panel_applets_to_load, l);
+    mate_panel_applet_load_queued(applet);
+    loaded = TRUE;
+    break;
+  }
+
+  if (!loaded) {
+    /* All the remaining objects don't have a panel */
+    for (l = mate_panel_applets_to_load; l; l = l->next) {
+      applet = l->data;
+
+      mate_panel_applet_pending_unref(applet->toplevel_id);
+      free_applet_to_load(applet);
+    }
+    g_slist_free(mate_panel_applets_to_load);
+    mate_panel_applets_to_load = NULL;
+  }
+
+  if (mate_panel_applets_to_load) return TRUE;
+
+  mate_panel_applet_have_load_idle = FALSE;
+
+  if (!mate_panel_applet_is_loading()) {
+    /* unhide any potential initially hidden toplevel */
+    mate_panel_applet_queue_initial_unhide_toplevels(NULL);
+  }
+
+  return FALSE;
 }
 
 void mate_panel_applet_queue_applet_to_load(
@@ -860,6 +966,13 @@ void mate_panel_applet_queue_applet_to_load(
     return;
   }
 
+  /* replacing it would lose track of the first one, and the count of the
+   * objects its toplevel waits for */
+  if (mate_panel_applet_on_load_queue(id)) {
+    g_warning("Object '%s' is already being loaded\n", id);
+    return;
+  }
+
   applet = g_new0(MatePanelAppletToLoad, 1);
 
   applet->id = g_strdup(id);
@@ -871,6 +984,9 @@ void mate_panel_applet_queue_applet_to_load(
 
   mate_panel_applets_to_load =
       g_slist_prepend(mate_panel_applets_to_load, applet);
+  mate_panel_applet_pending_ref(applet->toplevel_id);
+
+  panel_trace_instant("queue-object", id);
 }
 
 static int mate_panel_applet_compare(const MatePanelAppletToLoad *a,
@@ -1041,6 +1157,9 @@ void mate_panel_applet_save_position(AppletInfo *applet_info, const char *id,
           position)
     g_settings_set_int(applet_info->settings, PANEL_OBJECT_POSITION_KEY,
                        position);
+
+  /* do not depend on when the change notifications get emitted */
+  mate_panel_applet_update_placement(applet_info);
 }
 
 const char *mate_panel_applet_get_id(AppletInfo *info) {
@@ -1049,30 +1168,21 @@ const char *mate_panel_applet_get_id(AppletInfo *info) {
   return info->id;
 }
 
-const char *mate_panel_applet_get_id_by_widget(GtkWidget *applet_widget) {
-  GSList *l;
+AppletInfo *mate_panel_applet_get_by_widget(GtkWidget *applet_widget) {
+  if (!applet_widget || !applets_by_widget) return NULL;
 
-  if (!applet_widget) return NULL;
-
-  for (l = registered_applets; l; l = l->next) {
-    AppletInfo *info = l->data;
-
-    if (info->widget == applet_widget) return info->id;
-  }
+  return g_hash_table_lookup(applets_by_widget, applet_widget);
+}
 
-  return NULL;
+const char *mate_panel_applet_get_id_by_widget(GtkWidget *applet_widget) {
+  return mate_panel_applet_get_id(
+      mate_panel_applet_get_by_widget(applet_widget));
 }
 
 AppletInfo *mate_panel_applet_get_by_id(const char *id) {
-  GSList *l;
-
-  for (l = registered_applets; l; l = l->next) {
-    AppletInfo *info = l->data;
-
-    if (!strcmp(info->id, id)) return info;
-  }
+  if (!id || !applets_by_id) return NULL;
 
-  return NULL;
+  return g_hash_table_lookup(applets_by_id, id);
 }
 
 GSList *mate_panel_applet_list_applets(void) { return registered_applets; }
@@ -1095,6 +1205,26 @@ AppletInfo *mate_panel_applet_get_by_type(PanelObjectType object_type,
   return NULL;
 }
 
+static void mate_panel_applet_update_placement(AppletInfo *info) {
+  info->position =
+      g_settings_get_int(info->settings, PANEL_OBJECT_POSITION_KEY);
+  info->edge_relativity =
+      g_settings_get_enum(info->settings, PANEL_OBJECT_RELATIVE_TO_EDGE_KEY);
+  info->right_stuck = g_settings_get_boolean(
+      info->settings, PANEL_OBJECT_PANEL_RIGHT_STICK_KEY);
+}
+
+static void mate_panel_applet_placement_notify(GSettings *settings,
+                                               const char *key,
+                                               AppletInfo *info) {
+  if (strcmp(key, PANEL_OBJECT_POSITION_KEY) != 0 &&
+      strcmp(key, PANEL_OBJECT_RELATIVE_TO_EDGE_KEY) != 0 &&
+      strcmp(key, PANEL_OBJECT_PANEL_RIGHT_STICK_KEY) != 0)
+    return;
+
+  mate_panel_applet_update_placement(info);
+}
+
 AppletInfo *mate_panel_applet_register(GtkWidget *applet, gpointer data,
                                        GDestroyNotify data_destroy,
                                        PanelWidget *panel, gboolean locked,
@@ -1137,6 +1267,11 @@ AppletInfo *mate_panel_applet_register(GtkWidget *applet, gpointer data,
                    G_OBJECT(applet));
   g_free(locked_changed);
 
+  /* the panel widget looks at these on each allocation */
+  mate_panel_applet_update_placement(info);
+  g_signal_connect(info->settings, "changed",
+                   G_CALLBACK(mate_panel_applet_placement_notify), info);
+
   if (type == PANEL_OBJECT_DRAWER) {
     Drawer *drawer = data;
     PanelWidget *assoc_panel;
@@ -1152,7 +1287,14 @@ AppletInfo *mate_panel_applet_register(GtkWidget *applet, gpointer data,
 
   g_object_set_data(G_OBJECT(applet), MATE_PANEL_APPLET_FORBIDDEN_PANELS, NULL);
 
+  if (!applets_by_id) {
+    applets_by_id = g_hash_table_new(g_str_hash, g_str_equal);
+    applets_by_widget = g_hash_table_new(g_direct_hash, g_direct_equal);
+  }
+
   registered_applets = g_slist_append(registered_applets, info);
+  g_hash_table_replace(applets_by_id, info->id, info);
+  g_hash_table_replace(applets_by_widget, applet, info);
 
   if (panel_widget_add(panel, applet, locked, pos, exactpos) == -1 &&
       panel_widget_add(panel, applet, locked, 0, TRUE) == -1) {
@@ -28,6 +28,11 @@ typedef struct {
   GSettings *settings;
 
   char *id;
+
+  /* placement keys of settings, kept up to date on change */
+  int position;
+  PanelObjectEdgeRelativity edge_relativity;
+  gboolean right_stuck;
 } AppletInfo;
 
 typedef gboolean (*CallbackEnabledFunc)(void);
@@ -55,6 +60,7 @@ void mate_panel_applet_stop_loading(const char *id);
 
 const char *mate_panel_applet_get_id(AppletInfo *info);
 const char *mate_panel_applet_get_id_by_widget(GtkWidget *widget);
+AppletInfo *mate_panel_applet_get_by_widget(GtkWidget *widget);
 AppletInfo *mate_panel_applet_get_by_id(const char *id);
 AppletInfo *mate_panel_applet_get_by_type(PanelObjectType object_type,
                                           GdkScreen *screen);
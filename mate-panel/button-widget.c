@@ -10,10 +10,15 @@
 #include <gtk/gtk.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "panel-config-global.h"
 #include "panel-enums-gsettings.h"
 #include "panel-enums.h"
 #include "panel-globals.h"
+#include "panel-icon-cache.h"
 #include "panel-marshal.h"
 #include "panel-typebuiltins.h"
 #include "panel-types.h"
@@ -54,17 +59,63 @@ enum {
 
 G_DEFINE_TYPE_WITH_PRIVATE(ButtonWidget, button_widget, GTK_TYPE_BUTTON)
 
-/* colorshift a surface */
-static void do_colorshift(cairo_surface_t *dest, cairo_surface_t *src,
-                          int shift) {
-  gint i, j;
-  gint width, height, has_alpha, srcrowstride, destrowstride;
+/* The prelight surface brightens the colors by a fixed amount. Pixels are
+ * native endian premultiplied ARGB32 (or RGB24 without alpha): each color
+ * byte gets a saturating add and is then clamped to the alpha, so that the
+ * result is still premultiplied and the alpha is kept as is. */
+#define BUTTON_WIDGET_COLORSHIFT 30
+
+static inline guint32 colorshift_pixel(guint32 pixel, guint32 alpha_fill) {
+  guint32 a, c, result;
+  int shift;
+
+  pixel |= alpha_fill;
+  a = pixel >> 24;
+  result = pixel & 0xff000000;
+
+  for (shift = 0; shift < 24; shift += 8) {
+    c = ((pixel >> shift) & 0xff) + BUTTON_WIDGET_COLORSHIFT;
+    result |= MIN(c, a) << shift;
+  }
+
+  return result;
+}
+
+#if defined(__SSE2__) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+/* Four pixels at a time, with the byte order of little endian words */
+static gint colorshift_row_sse2(const guint32 *src, guint32 *dest, gint width,
+                                guint32 alpha_fill) {
+  const __m128i shift = _mm_set1_epi32(BUTTON_WIDGET_COLORSHIFT * 0x010101);
+  const __m128i fill = _mm_set1_epi32(alpha_fill);
+  gint x;
+
+  for (x = 0; x + 4 <= width; x += 4) {
+    __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x));
+    __m128i alpha;
+
+    pixels = _mm_or_si128(pixels, fill);
+    alpha = _mm_srli_epi32(pixels, 24);
+    alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 8));
+    alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+
+    pixels = _mm_min_epu8(_mm_adds_epu8(pixels, shift), alpha);
+    _mm_storeu_si128((__m128i *)(dest + x), pixels);
+  }
+
+  return x;
+}
+#endif
+
+static void do_colorshift(cairo_surface_t *dest, cairo_surface_t *src) {
+  gint x, y;
+  gint width, height, srcrowstride, destrowstride;
   guchar *target_pixels;
   guchar *original_pixels;
-  int val;
-  guchar r, g, b;
+  guint32 alpha_fill;
 
-  has_alpha = cairo_surface_get_content(src) != CAIRO_CONTENT_COLOR;
+  alpha_fill = cairo_image_surface_get_format(src) == CAIRO_FORMAT_RGB24
+                   ? 0xff000000
+                   : 0;
   width = cairo_image_surface_get_width(src);
   height = cairo_image_surface_get_height(src);
   srcrowstride = cairo_image_surface_get_stride(src);
@@ -72,41 +123,52 @@ static void do_colorshift(cairo_surface_t *dest, cairo_surface_t *src,
   original_pixels = cairo_image_surface_get_data(src);
   target_pixels = cairo_image_surface_get_data(dest);
 
-  for (i = 0; i < height; i++) {
-    guchar *pixdest = target_pixels + i * destrowstride;
-    guchar *pixsrc = original_pixels + i * srcrowstride;
-    for (j = 0; j < width; j++) {
-      r = *(pixsrc++);
-      g = *(pixsrc++);
-      b = *(pixsrc++);
-      val = r + shift;
-      *(pixdest++) = CLAMP(val, 0, 255);
-      val = g + shift;
-      *(pixdest++) = CLAMP(val, 0, 255);
-      val = b + shift;
-      *(pixdest++) = CLAMP(val, 0, 255);
-      if (has_alpha) *(pixdest++) = *(pixsrc++);
-    }
+  for (y = 0; y < height; y++) {
+    const guint32 *pixsrc =
+        (const guint32 *)(original_pixels + y * srcrowstride);
+    guint32 *pixdest = (guint32 *)(target_pixels + y * destrowstride);
+
+    x = 0;
+#if defined(__SSE2__) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+    x = colorshift_row_sse2(pixsrc, pixdest, width, alpha_fill);
+#endif
+    for (; x < width; x++) pixdest[x] = colorshift_pixel(pixsrc[x], alpha_fill);
   }
 }
 
+static const cairo_user_data_key_t hc_surface_key;
+
+/* Only built when the button is first highlighted, most of them never are.
+ * The surfaces are shared by all the buttons with the same icon (see
+ * panel-icon-cache.c), so the prelight surface is kept with them. */
 static cairo_surface_t *make_hc_surface(cairo_surface_t *surface) {
-  cairo_t *cr;
   cairo_surface_t *new;
+  cairo_format_t format;
+  double x_scale, y_scale;
 
   if (!surface) return NULL;
 
-  new =
-      cairo_surface_create_similar(surface, cairo_surface_get_content(surface),
+  new = cairo_surface_get_user_data(surface, &hc_surface_key);
+  if (new) return cairo_surface_reference(new);
+
+  format = cairo_image_surface_get_format(surface);
+  if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+    return cairo_surface_reference(surface);
+
+  new = cairo_image_surface_create(format,
                                    cairo_image_surface_get_width(surface),
                                    cairo_image_surface_get_height(surface));
+  cairo_surface_get_device_scale(surface, &x_scale, &y_scale);
+  cairo_surface_set_device_scale(new, x_scale, y_scale);
 
-  do_colorshift(new, surface, 30);
+  cairo_surface_flush(surface);
+  cairo_surface_flush(new);
+  do_colorshift(new, surface);
+  cairo_surface_mark_dirty(new);
 
-  cr = cairo_create(new);
-  cairo_set_operator(cr, CAIRO_OPERATOR_DEST_IN);
-  cairo_mask_surface(cr, surface, 0, 0);
-  cairo_destroy(cr);
+  cairo_surface_set_user_data(surface, &hc_surface_key,
+                              cairo_surface_reference(new),
+                              (cairo_destroy_func_t)cairo_surface_destroy);
 
   return new;
 }
@@ -120,9 +182,10 @@ static void button_widget_realize(GtkWidget *widget) {
 
   BUTTON_WIDGET(widget)->priv->icon_theme =
       gtk_icon_theme_get_for_screen(gtk_widget_get_screen(widget));
+  /* after the icon cache dropped the surfaces of the old theme */
   g_signal_connect_object(BUTTON_WIDGET(widget)->priv->icon_theme, "changed",
                           G_CALLBACK(button_widget_icon_theme_changed), widget,
-                          G_CONNECT_SWAPPED);
+                          G_CONNECT_SWAPPED | G_CONNECT_AFTER);
 
   button_widget_reload_surface(BUTTON_WIDGET(widget));
 }
@@ -154,16 +217,16 @@ static void button_widget_reload_surface(ButtonWidget *button) {
 
     scale = gtk_widget_get_scale_factor(GTK_WIDGET(button));
 
-    button->priv->surface =
-        panel_load_icon(button->priv->icon_theme, button->priv->filename,
-                        button->priv->size * scale,
-                        (button->priv->orientation & PANEL_VERTICAL_MASK)
-                            ? button->priv->size * scale
-                            : -1,
-                        (button->priv->orientation & PANEL_HORIZONTAL_MASK)
-                            ? button->priv->size * scale
-                            : -1,
-                        &error);
+    button->priv->surface = panel_icon_cache_load(
+        button->priv->icon_theme, button->priv->filename,
+        button->priv->size * scale,
+        (button->priv->orientation & PANEL_VERTICAL_MASK)
+            ? button->priv->size * scale
+            : -1,
+        (button->priv->orientation & PANEL_HORIZONTAL_MASK)
+            ? button->priv->size * scale
+            : -1,
+        &error);
     if (error) {
       /* FIXME: this is not rendered at button->priv->size */
       GtkIconTheme *icon_theme = gtk_icon_theme_get_default();
@@ -174,8 +237,6 @@ static void button_widget_reload_surface(ButtonWidget *button) {
     }
   }
 
-  button->priv->surface_hc = make_hc_surface(button->priv->surface);
-
   gtk_widget_queue_resize(GTK_WIDGET(button));
 }
 
@@ -321,8 +382,7 @@ static gboolean button_widget_draw(GtkWidget *widget, cairo_t *cr) {
 
   button_widget = BUTTON_WIDGET(widget);
 
-  if (!button_widget->priv->surface_hc && !button_widget->priv->surface)
-    return FALSE;
+  if (!button_widget->priv->surface) return FALSE;
 
   state_flags = gtk_widget_get_state_flags(widget);
   width = gtk_widget_get_allocated_width(widget);
@@ -351,6 +411,9 @@ static gboolean button_widget_draw(GtkWidget *widget, cairo_t *cr) {
   } else if (panel_global_config_get_highlight_when_over() &&
              (state_flags & GTK_STATE_FLAG_PRELIGHT ||
               gtk_widget_has_focus(widget))) {
+    if (!button_widget->priv->surface_hc)
+      button_widget->priv->surface_hc =
+          make_hc_surface(button_widget->priv->surface);
     cairo_set_source_surface(cr, button_widget->priv->surface_hc, x, y);
   } else {
     cairo_set_source_surface(cr, button_widget->priv->surface, x, y);
@@ -34,6 +34,8 @@
 
 #include <panel-applets-manager.h>
 
+#include <libpanel-util/panel-trace.h>
+
 #include "panel-applet-container.h"
 #include "panel-marshal.h"
 
@@ -50,6 +52,9 @@ struct _MatePanelAppletContainerPrivate {
   GtkWidget *socket;
 
   GHashTable *pending_ops;
+
+  /* the applet predates the Configure method */
+  gboolean configure_unsupported;
 };
 
 enum {
@@ -92,6 +97,15 @@ static gboolean mate_panel_applet_container_plug_removed(
 G_DEFINE_TYPE_WITH_PRIVATE(MatePanelAppletContainer,
                            mate_panel_applet_container, GTK_TYPE_EVENT_BOX);
 
+/* Calls made to all the applets, traced as a counter: the increase across
+ * a change of the panel is the number of round trips it cost */
+static gint64 applet_round_trips = 0;
+
+static void mate_panel_applet_container_count_round_trip(void) {
+  applet_round_trips++;
+  panel_trace_counter("applet-round-trips", applet_round_trips);
+}
+
 GQuark mate_panel_applet_container_error_quark(void) {
   return g_quark_from_static_string("mate-panel-applet-container-error-quark");
 }
@@ -295,6 +309,22 @@ static void on_property_changed(GDBusConnection *connection,
   g_variant_unref(props);
 }
 
+/* Steps of the applet activation are traced as asynchronous events,
+ * identified by the container since they overlap for different applets */
+static void mate_panel_applet_container_trace(GTask *task, const char *name,
+                                              gboolean begin) {
+  char id[32];
+
+  if (!panel_trace_is_enabled()) return;
+
+  g_snprintf(id, sizeof(id), "%p", g_task_get_source_object(task));
+
+  if (begin)
+    panel_trace_async_begin(name, id);
+  else
+    panel_trace_async_end(name, id);
+}
+
 static void on_proxy_appeared(GObject *source_object, GAsyncResult *res,
                               gpointer user_data) {
   GTask *task = G_TASK(user_data);
@@ -302,6 +332,8 @@ static void on_proxy_appeared(GObject *source_object, GAsyncResult *res,
   GDBusProxy *proxy;
   GError *error = NULL;
 
+  mate_panel_applet_container_trace(task, "applet-proxy", FALSE);
+
   proxy = g_dbus_proxy_new_finish(res, &error);
   if (!proxy) {
     g_task_return_error(task, error);
@@ -349,6 +381,8 @@ static void get_applet_cb(GObject *source_object, GAsyncResult *res,
   const gchar *applet_path;
   GError *error = NULL;
 
+  mate_panel_applet_container_trace(task, "get-applet", FALSE);
+
   retvals = g_dbus_connection_call_finish(connection, res, &error);
   if (!retvals) {
     g_task_return_error(task, error);
@@ -363,6 +397,7 @@ static void get_applet_cb(GObject *source_object, GAsyncResult *res,
                 &container->priv->out_of_process, &container->priv->xid,
                 &container->priv->uid);
 
+  mate_panel_applet_container_trace(task, "applet-proxy", TRUE);
   g_dbus_proxy_new(connection, G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES, NULL,
                    container->priv->bus_name, applet_path,
                    MATE_PANEL_APPLET_INTERFACE, NULL,
@@ -393,12 +428,15 @@ static void on_factory_appeared(GDBusConnection *connection, const gchar *name,
   gchar *object_path;
   AppletFactoryData *data;
 
+  mate_panel_applet_container_trace(task, "factory-activation", FALSE);
+
   data = g_task_get_task_data(task);
   container = MATE_PANEL_APPLET_CONTAINER(
       g_async_result_get_source_object(G_ASYNC_RESULT(task)));
   container->priv->bus_name = g_strdup(name_owner);
   object_path =
       g_strdup_printf(MATE_PANEL_APPLET_FACTORY_OBJECT_PATH, data->factory_id);
+  mate_panel_applet_container_trace(task, "get-applet", TRUE);
   g_dbus_connection_call(
       connection, name_owner, object_path, MATE_PANEL_APPLET_FACTORY_INTERFACE,
       "GetApplet", data->parameters, G_VARIANT_TYPE("(obuu)"),
@@ -450,6 +488,8 @@ static void mate_panel_applet_container_get_applet(
   bus_name = g_strdup_printf(MATE_PANEL_APPLET_BUS_NAME, factory_id);
 
   container->priv->iid = g_strdup(iid);
+  panel_trace_instant("add-applet", iid);
+  mate_panel_applet_container_trace(task, "factory-activation", TRUE);
   container->priv->name_watcher_id = g_bus_watch_name(
       G_BUS_TYPE_SESSION, bus_name, G_BUS_NAME_WATCHER_FLAGS_AUTO_START,
       (GBusNameAppearedCallback)on_factory_appeared, NULL, task, NULL);
@@ -536,6 +576,7 @@ gconstpointer mate_panel_applet_container_child_set(
     cancellable = g_cancellable_new();
   g_hash_table_insert(container->priv->pending_ops, task, cancellable);
 
+  mate_panel_applet_container_count_round_trip();
   g_dbus_connection_call(
       g_dbus_proxy_get_connection(proxy), g_dbus_proxy_get_name(proxy),
       g_dbus_proxy_get_object_path(proxy), "org.freedesktop.DBus.Properties",
@@ -611,6 +652,7 @@ gconstpointer mate_panel_applet_container_child_get(
     cancellable = g_cancellable_new();
   g_hash_table_insert(container->priv->pending_ops, task, cancellable);
 
+  mate_panel_applet_container_count_round_trip();
   g_dbus_connection_call(
       g_dbus_proxy_get_connection(proxy), g_dbus_proxy_get_name(proxy),
       g_dbus_proxy_get_object_path(proxy), "org.freedesktop.DBus.Properties",
@@ -632,6 +674,191 @@ GVariant *mate_panel_applet_container_child_get_finish(
   return g_variant_ref(g_task_propagate_pointer(G_TASK(result), error));
 }
 
+typedef struct {
+  GVariant *properties;
+  GCancellable *cancellable;
+  guint n_pending;
+  GError *error;
+} ConfigureData;
+
+static void configure_data_free(ConfigureData *data) {
+  g_variant_unref(data->properties);
+  g_object_unref(data->cancellable);
+  g_clear_error(&data->error);
+  g_free(data);
+}
+
+static void mate_panel_applet_container_configure_done(GTask *task) {
+  MatePanelAppletContainer *container =
+      MATE_PANEL_APPLET_CONTAINER(g_task_get_source_object(task));
+  ConfigureData *data = g_task_get_task_data(task);
+
+  if (container->priv->pending_ops)
+    g_hash_table_remove(container->priv->pending_ops, task);
+
+  if (data->error)
+    g_task_return_error(task, g_steal_pointer(&data->error));
+  else
+    g_task_return_boolean(task, TRUE);
+  g_object_unref(task);
+}
+
+static void configure_fallback_cb(GObject *source_object, GAsyncResult *res,
+                                  gpointer user_data) {
+  GTask *task = G_TASK(user_data);
+  ConfigureData *data = g_task_get_task_data(task);
+  GVariant *retvals;
+  GError *error = NULL;
+
+  retvals = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object),
+                                          res, &error);
+  if (retvals) {
+    g_variant_unref(retvals);
+  } else if (!data->error) {
+    data->error = error;
+  } else {
+    g_error_free(error);
+  }
+
+  if (--data->n_pending == 0)
+    mate_panel_applet_container_configure_done(task);
+  else
+    g_object_unref(task);
+}
+
+/* One Set call per property, for applets built against an older library */
+static void mate_panel_applet_container_configure_fallback(GTask *task) {
+  MatePanelAppletContainer *container =
+      MATE_PANEL_APPLET_CONTAINER(g_task_get_source_object(task));
+  GDBusProxy *proxy = container->priv->applet_proxy;
+  ConfigureData *data = g_task_get_task_data(task);
+  GVariantIter iter;
+  const gchar *dbus_name;
+  GVariant *value;
+
+  data->n_pending = g_variant_n_children(data->properties);
+  if (!proxy || data->n_pending == 0) {
+    mate_panel_applet_container_configure_done(task);
+    return;
+  }
+
+  g_variant_iter_init(&iter, data->properties);
+  while (g_variant_iter_next(&iter, "{&sv}", &dbus_name, &value)) {
+    mate_panel_applet_container_count_round_trip();
+    g_dbus_connection_call(
+        g_dbus_proxy_get_connection(proxy), g_dbus_proxy_get_name(proxy),
+        g_dbus_proxy_get_object_path(proxy), "org.freedesktop.DBus.Properties",
+        "Set",
+        g_variant_new("(ssv)", g_dbus_proxy_get_interface_name(proxy),
+                      dbus_name, value),
+        NULL, G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, data->cancellable,
+        configure_fallback_cb, g_object_ref(task));
+    g_variant_unref(value);
+  }
+
+  g_object_unref(task);
+}
+
+static void configure_applet_cb(GObject *source_object, GAsyncResult *res,
+                                gpointer user_data) {
+  GTask *task = G_TASK(user_data);
+  MatePanelAppletContainer *container =
+      MATE_PANEL_APPLET_CONTAINER(g_task_get_source_object(task));
+  ConfigureData *data = g_task_get_task_data(task);
+  GVariant *retvals;
+  GError *error = NULL;
+
+  retvals = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object),
+                                          res, &error);
+  if (retvals) {
+    g_variant_unref(retvals);
+  } else if (g_error_matches(error, G_DBUS_ERROR,
+                             G_DBUS_ERROR_UNKNOWN_METHOD)) {
+    g_error_free(error);
+    container->priv->configure_unsupported = TRUE;
+    mate_panel_applet_container_configure_fallback(task);
+    return;
+  } else {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning("Error configuring applet: %s\n", error->message);
+    data->error = error;
+  }
+
+  mate_panel_applet_container_configure_done(task);
+}
+
+/* Sets several child properties in a single call, which the applet applies
+ * at once. @properties is a floating or owned a{sv} dictionary keyed by the
+ * child property names; unknown names are ignored. */
+gconstpointer mate_panel_applet_container_child_configure(
+    MatePanelAppletContainer *container, GVariant *properties,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
+  GDBusProxy *proxy = container->priv->applet_proxy;
+  GVariantBuilder builder;
+  GVariantIter iter;
+  const gchar *property_name;
+  GVariant *value;
+  ConfigureData *data;
+  GTask *task;
+
+  g_variant_ref_sink(properties);
+
+  if (!proxy) {
+    g_variant_unref(properties);
+    return NULL;
+  }
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_iter_init(&iter, properties);
+  while (g_variant_iter_next(&iter, "{&sv}", &property_name, &value)) {
+    const AppletPropertyInfo *info;
+
+    info = mate_panel_applet_container_child_property_get_info(property_name);
+    if (info)
+      g_variant_builder_add(&builder, "{sv}", info->dbus_name, value);
+    else
+      g_warning("Applet has no child property named `%s'", property_name);
+    g_variant_unref(value);
+  }
+  g_variant_unref(properties);
+
+  task = g_task_new(G_OBJECT(container), cancellable, callback, user_data);
+  g_task_set_source_tag(task, mate_panel_applet_container_child_configure);
+
+  data = g_new0(ConfigureData, 1);
+  data->properties = g_variant_ref_sink(g_variant_builder_end(&builder));
+  data->cancellable =
+      cancellable ? g_object_ref(cancellable) : g_cancellable_new();
+  g_task_set_task_data(task, data, (GDestroyNotify)configure_data_free);
+
+  g_hash_table_insert(container->priv->pending_ops, task,
+                      g_object_ref(data->cancellable));
+
+  if (container->priv->configure_unsupported) {
+    mate_panel_applet_container_configure_fallback(task);
+    return task;
+  }
+
+  mate_panel_applet_container_count_round_trip();
+  g_dbus_connection_call(
+      g_dbus_proxy_get_connection(proxy), g_dbus_proxy_get_name(proxy),
+      g_dbus_proxy_get_object_path(proxy), MATE_PANEL_APPLET_INTERFACE,
+      "Configure", g_variant_new("(@a{sv})", data->properties), NULL,
+      G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, data->cancellable,
+      configure_applet_cb, task);
+
+  return task;
+}
+
+gboolean mate_panel_applet_container_child_configure_finish(
+    MatePanelAppletContainer *container, GAsyncResult *result, GError **error) {
+  g_return_val_if_fail(g_task_is_valid(result, container), FALSE);
+  g_warn_if_fail(g_task_get_source_tag(G_TASK(result)) ==
+                 mate_panel_applet_container_child_configure);
+  return g_task_propagate_boolean(G_TASK(result), error);
+}
+
 static void child_popup_menu_cb(GObject *source_object, GAsyncResult *res,
                                 gpointer user_data) {
   GDBusConnection *connection = G_DBUS_CONNECTION(source_object);
@@ -662,6 +889,7 @@ void mate_panel_applet_container_child_popup_menu(
   task = g_task_new(G_OBJECT(container), cancellable, callback, user_data);
   g_task_set_source_tag(task, mate_panel_applet_container_child_popup_menu);
 
+  mate_panel_applet_container_count_round_trip();
   g_dbus_connection_call(
       g_dbus_proxy_get_connection(proxy), g_dbus_proxy_get_name(proxy),
       g_dbus_proxy_get_object_path(proxy), MATE_PANEL_APPLET_INTERFACE,
@@ -107,6 +107,12 @@ gconstpointer mate_panel_applet_container_child_get(
     gpointer user_data);
 GVariant *mate_panel_applet_container_child_get_finish(
     MatePanelAppletContainer *container, GAsyncResult *result, GError **error);
+gconstpointer mate_panel_applet_container_child_configure(
+    MatePanelAppletContainer *container, GVariant *properties,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+gboolean mate_panel_applet_container_child_configure_finish(
+    MatePanelAppletContainer *container, GAsyncResult *result, GError **error);
 
 void mate_panel_applet_container_cancel_operation(
     MatePanelAppletContainer *container, gconstpointer operation);
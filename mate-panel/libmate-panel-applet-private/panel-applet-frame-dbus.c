@@ -40,7 +40,17 @@
 
 struct _MatePanelAppletFrameDBusPrivate {
   MatePanelAppletContainer *container;
-  gconstpointer bg_operation;
+
+  /* child properties waiting for the next Configure call; the background
+   * string is only computed then, from the final allocation */
+  GHashTable *pending_props;
+  gboolean bg_pending;
+  PanelBackgroundType bg_type;
+  guint configure_tick_id;
+  guint configure_idle_id;
+
+  /* the last background sent to the applet */
+  char *bg_str;
 };
 
 /* Keep in sync with mate-panel-applet.h. Uggh. */
@@ -145,17 +155,152 @@ static void mate_panel_applet_frame_dbus_init_properties(
       frame);
 }
 
+typedef struct {
+  MatePanelAppletFrameDBus *frame;
+  gboolean orient_changed;
+} ConfigureData;
+
+static void configure_data_free(ConfigureData *data) {
+  g_object_unref(data->frame);
+  g_free(data);
+}
+
+static void mate_panel_applet_frame_dbus_configure_cb(GObject *source_object,
+                                                      GAsyncResult *res,
+                                                      gpointer user_data) {
+  MatePanelAppletContainer *container =
+      MATE_PANEL_APPLET_CONTAINER(source_object);
+  ConfigureData *data = user_data;
+  GError *error = NULL;
+
+  if (!mate_panel_applet_container_child_configure_finish(container, res,
+                                                           &error)) {
+    /* the applet may not have the background we think it has */
+    g_clear_pointer(&data->frame->priv->bg_str, g_free);
+    g_error_free(error);
+  } else if (data->orient_changed) {
+    gtk_widget_queue_resize(GTK_WIDGET(data->frame));
+  }
+
+  configure_data_free(data);
+}
+
+/* Sends all the changes queued since the last frame in one call */
+static void mate_panel_applet_frame_dbus_configure(
+    MatePanelAppletFrameDBus *dbus_frame) {
+  MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
+  MatePanelAppletFrame *frame = MATE_PANEL_APPLET_FRAME(dbus_frame);
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  gpointer name, value;
+  ConfigureData *data;
+
+  /* the frame is being destroyed */
+  if (!priv->container) return;
+
+  if (priv->bg_pending) {
+    GtkWidget *parent = gtk_widget_get_parent(GTK_WIDGET(frame));
+    char *bg_str = NULL;
+
+    priv->bg_pending = FALSE;
+
+    if (PANEL_IS_WIDGET(parent))
+      bg_str = _mate_panel_applet_frame_get_background_string(
+          frame, PANEL_WIDGET(parent), priv->bg_type);
+
+    /* the applet may already have it: this is common when the panel is
+     * resized or repainted without the applet moving */
+    if (bg_str && g_strcmp0(bg_str, priv->bg_str) != 0) {
+      g_hash_table_insert(priv->pending_props, (gpointer) "background",
+                          g_variant_ref_sink(g_variant_new_string(bg_str)));
+      g_free(priv->bg_str);
+      priv->bg_str = bg_str;
+    } else {
+      g_free(bg_str);
+    }
+  }
+
+  if (g_hash_table_size(priv->pending_props) == 0) return;
+
+  data = g_new(ConfigureData, 1);
+  data->frame = g_object_ref(dbus_frame);
+  data->orient_changed = g_hash_table_contains(priv->pending_props, "orient");
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+  g_hash_table_iter_init(&iter, priv->pending_props);
+  while (g_hash_table_iter_next(&iter, &name, &value))
+    g_variant_builder_add(&builder, "{sv}", name, value);
+  g_hash_table_remove_all(priv->pending_props);
+
+  if (!mate_panel_applet_container_child_configure(
+          priv->container, g_variant_builder_end(&builder), NULL,
+          mate_panel_applet_frame_dbus_configure_cb, data)) {
+    /* the applet is not running (yet): nothing was sent */
+    g_clear_pointer(&priv->bg_str, g_free);
+    configure_data_free(data);
+  }
+}
+
+static gboolean mate_panel_applet_frame_dbus_configure_tick(
+    GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data) {
+  MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS(widget);
+
+  dbus_frame->priv->configure_tick_id = 0;
+  mate_panel_applet_frame_dbus_configure(dbus_frame);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean mate_panel_applet_frame_dbus_configure_idle(
+    gpointer user_data) {
+  MatePanelAppletFrameDBus *dbus_frame =
+      MATE_PANEL_APPLET_FRAME_DBUS(user_data);
+
+  dbus_frame->priv->configure_idle_id = 0;
+  mate_panel_applet_frame_dbus_configure(dbus_frame);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Changing the size or orientation of a panel, or dragging an applet along
+ * it, changes several properties of the applet, some of them many times
+ * per frame. They are merged until the next frame, so that the applet gets
+ * a single call and lays itself out once. */
+static void mate_panel_applet_frame_dbus_queue_configure(
+    MatePanelAppletFrameDBus *dbus_frame) {
+  MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
+
+  if (!priv->container) return;
+
+  if (priv->configure_tick_id || priv->configure_idle_id) return;
+
+  /* the frame clock does not tick for a panel that is not shown */
+  if (gtk_widget_get_mapped(GTK_WIDGET(dbus_frame)))
+    priv->configure_tick_id = gtk_widget_add_tick_callback(
+        GTK_WIDGET(dbus_frame), mate_panel_applet_frame_dbus_configure_tick,
+        NULL, NULL);
+  else
+    priv->configure_idle_id =
+        g_idle_add(mate_panel_applet_frame_dbus_configure_idle, dbus_frame);
+}
+
+static void mate_panel_applet_frame_dbus_queue_property(
+    MatePanelAppletFrameDBus *dbus_frame, const gchar *property_name,
+    GVariant *value) {
+  g_hash_table_insert(dbus_frame->priv->pending_props, (gpointer)property_name,
+                      g_variant_ref_sink(value));
+  mate_panel_applet_frame_dbus_queue_configure(dbus_frame);
+}
+
 static void mate_panel_applet_frame_dbus_sync_menu_state(
     MatePanelAppletFrame *frame, gboolean movable, gboolean removable,
     gboolean lockable, gboolean locked, gboolean locked_down) {
   MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS(frame);
 
-  mate_panel_applet_container_child_set(
-      dbus_frame->priv->container, "locked",
-      g_variant_new_boolean(lockable && locked), NULL, NULL, NULL);
-  mate_panel_applet_container_child_set(
-      dbus_frame->priv->container, "locked-down",
-      g_variant_new_boolean(locked_down), NULL, NULL, NULL);
+  mate_panel_applet_frame_dbus_queue_property(
+      dbus_frame, "locked", g_variant_new_boolean(lockable && locked));
+  mate_panel_applet_frame_dbus_queue_property(
+      dbus_frame, "locked-down", g_variant_new_boolean(locked_down));
 }
 
 static void mate_panel_applet_frame_dbus_popup_menu(MatePanelAppletFrame *frame,
@@ -167,72 +312,30 @@ static void mate_panel_applet_frame_dbus_popup_menu(MatePanelAppletFrame *frame,
       dbus_frame->priv->container, button, timestamp, NULL, NULL, NULL);
 }
 
-static void change_orientation_cb(MatePanelAppletContainer *container,
-                                  GAsyncResult *res,
-                                  MatePanelAppletFrame *frame) {
-  GError *error = NULL;
-
-  if (!mate_panel_applet_container_child_set_finish(container, res, &error)) {
-    g_warning("%s\n", error->message);
-    g_error_free(error);
-
-    return;
-  }
-
-  gtk_widget_queue_resize(GTK_WIDGET(frame));
-}
-
 static void mate_panel_applet_frame_dbus_change_orientation(
     MatePanelAppletFrame *frame, PanelOrientation orientation) {
   MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS(frame);
 
-  mate_panel_applet_container_child_set(
-      dbus_frame->priv->container, "orient",
-      g_variant_new_uint32(get_mate_panel_applet_orient(orientation)), NULL,
-      (GAsyncReadyCallback)change_orientation_cb, frame);
+  mate_panel_applet_frame_dbus_queue_property(
+      dbus_frame, "orient",
+      g_variant_new_uint32(get_mate_panel_applet_orient(orientation)));
 }
 
 static void mate_panel_applet_frame_dbus_change_size(
     MatePanelAppletFrame *frame, guint size) {
   MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS(frame);
 
-  mate_panel_applet_container_child_set(dbus_frame->priv->container, "size",
-                                        g_variant_new_uint32(size), NULL, NULL,
-                                        NULL);
-}
-
-static void container_child_background_set(GObject *source_object,
-                                           GAsyncResult *res,
-                                           gpointer user_data) {
-  MatePanelAppletContainer *container =
-      MATE_PANEL_APPLET_CONTAINER(source_object);
-  MatePanelAppletFrameDBus *frame = MATE_PANEL_APPLET_FRAME_DBUS(user_data);
-
-  mate_panel_applet_container_child_set_finish(container, res, NULL);
-
-  frame->priv->bg_operation = NULL;
+  mate_panel_applet_frame_dbus_queue_property(dbus_frame, "size",
+                                              g_variant_new_uint32(size));
 }
 
 static void mate_panel_applet_frame_dbus_change_background(
     MatePanelAppletFrame *frame, PanelBackgroundType type) {
   MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS(frame);
-  MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
-  char *bg_str;
-
-  bg_str = _mate_panel_applet_frame_get_background_string(
-      frame, PANEL_WIDGET(gtk_widget_get_parent(GTK_WIDGET(frame))), type);
-
-  if (bg_str != NULL) {
-    if (priv->bg_operation)
-      mate_panel_applet_container_cancel_operation(priv->container,
-                                                   priv->bg_operation);
-
-    priv->bg_operation = mate_panel_applet_container_child_set(
-        priv->container, "background", g_variant_new_string(bg_str), NULL,
-        container_child_background_set, dbus_frame);
 
-    g_free(bg_str);
-  }
+  dbus_frame->priv->bg_pending = TRUE;
+  dbus_frame->priv->bg_type = type;
+  mate_panel_applet_frame_dbus_queue_configure(dbus_frame);
 }
 
 static void mate_panel_applet_frame_dbus_flags_changed(
@@ -278,10 +381,45 @@ static void mate_panel_applet_frame_dbus_applet_lock(
   _mate_panel_applet_frame_applet_lock(frame, locked);
 }
 
+static void mate_panel_applet_frame_dbus_unmap(GtkWidget *widget) {
+  MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS(widget);
+
+  GTK_WIDGET_CLASS(mate_panel_applet_frame_dbus_parent_class)->unmap(widget);
+
+  /* the tick would not come before the panel is shown again */
+  if (dbus_frame->priv->configure_tick_id) {
+    gtk_widget_remove_tick_callback(widget,
+                                    dbus_frame->priv->configure_tick_id);
+    dbus_frame->priv->configure_tick_id = 0;
+    mate_panel_applet_frame_dbus_queue_configure(dbus_frame);
+  }
+}
+
+static void mate_panel_applet_frame_dbus_dispose(GObject *object) {
+  MatePanelAppletFrameDBus *frame = MATE_PANEL_APPLET_FRAME_DBUS(object);
+
+  /* An in-flight configure call keeps the frame alive past its
+   * destruction: stop sending anything as soon as it is destroyed, the
+   * unmap done while disposing included. */
+  frame->priv->container = NULL;
+
+  if (frame->priv->configure_tick_id)
+    gtk_widget_remove_tick_callback(GTK_WIDGET(frame),
+                                    frame->priv->configure_tick_id);
+  frame->priv->configure_tick_id = 0;
+
+  if (frame->priv->configure_idle_id)
+    g_source_remove(frame->priv->configure_idle_id);
+  frame->priv->configure_idle_id = 0;
+
+  G_OBJECT_CLASS(mate_panel_applet_frame_dbus_parent_class)->dispose(object);
+}
+
 static void mate_panel_applet_frame_dbus_finalize(GObject *object) {
   MatePanelAppletFrameDBus *frame = MATE_PANEL_APPLET_FRAME_DBUS(object);
 
-  frame->priv->bg_operation = NULL;
+  g_hash_table_destroy(frame->priv->pending_props);
+  g_free(frame->priv->bg_str);
 
   G_OBJECT_CLASS(mate_panel_applet_frame_dbus_parent_class)->finalize(object);
 }
@@ -295,7 +433,13 @@ static void mate_panel_applet_frame_dbus_init(MatePanelAppletFrameDBus *frame) {
   gtk_widget_show(container);
   gtk_container_add(GTK_CONTAINER(frame), container);
   frame->priv->container = MATE_PANEL_APPLET_CONTAINER(container);
-  frame->priv->bg_operation = NULL;
+  frame->priv->pending_props = g_hash_table_new_full(
+      g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_variant_unref);
+  frame->priv->bg_pending = FALSE;
+  frame->priv->bg_type = PANEL_BACK_NONE;
+  frame->priv->configure_tick_id = 0;
+  frame->priv->configure_idle_id = 0;
+  frame->priv->bg_str = NULL;
 
   g_signal_connect(container, "child-property-changed::flags",
                    G_CALLBACK(mate_panel_applet_frame_dbus_flags_changed),
@@ -320,6 +464,7 @@ static void mate_panel_applet_frame_dbus_class_init(
   GObjectClass *gobject_class = G_OBJECT_CLASS(class);
   MatePanelAppletFrameClass *frame_class = MATE_PANEL_APPLET_FRAME_CLASS(class);
 
+  gobject_class->dispose = mate_panel_applet_frame_dbus_dispose;
   gobject_class->finalize = mate_panel_applet_frame_dbus_finalize;
 
   frame_class->init_properties = mate_panel_applet_frame_dbus_init_properties;
@@ -332,6 +477,7 @@ static void mate_panel_applet_frame_dbus_class_init(
       mate_panel_applet_frame_dbus_change_background;
 
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(class);
+  widget_class->unmap = mate_panel_applet_frame_dbus_unmap;
   gtk_widget_class_set_css_name(widget_class, "MatePanelAppletFrameDBus");
 }
 
@@ -27,8 +27,11 @@
 
 #include "panel-applets-manager-dbus.h"
 
+#include <errno.h>
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
+#include <libpanel-util/panel-trace.h>
 #include <panel-applets-manager.h>
 #include <string.h>
 
@@ -69,12 +72,24 @@ typedef struct _MatePanelAppletFactoryInfo {
   gchar *srcdir;
 
   GList *applet_list;
+  /* applet_list as read from the registry, until it is needed */
+  GVariant *applets;
   gboolean has_old_ids;
 } MatePanelAppletFactoryInfo;
 
 #define MATE_PANEL_APPLET_FACTORY_GROUP "Applet Factory"
 #define MATE_PANEL_APPLETS_EXTENSION ".mate-panel-applet"
 
+/* The registry caches the parsed applet files, so that the startup maps
+ * one file instead of reading all of them. It is only valid for the same
+ * applet directories with the same modification times, the same
+ * languages and the same MATE_PANEL_APPLET_LIB_PREFIX. */
+#define MATE_PANEL_APPLETS_REGISTRY_FILE "applets-registry"
+#define MATE_PANEL_APPLETS_REGISTRY_VERSION 1
+#define MATE_PANEL_APPLETS_REGISTRY_TYPE "(ussa(sx)a(sbmssba(smsmsmsasbb)))"
+#define MATE_PANEL_APPLETS_REGISTRY_FACTORY_TYPE "(sbmssba(smsmsmsasbb))"
+#define MATE_PANEL_APPLETS_REGISTRY_APPLET_TYPE "(smsmsmsasbb)"
+
 static void mate_panel_applet_factory_info_free(
     MatePanelAppletFactoryInfo *info) {
   if (!info) return;
@@ -83,11 +98,43 @@ static void mate_panel_applet_factory_info_free(
   g_free(info->location);
   g_list_free_full(info->applet_list, mate_panel_applet_info_free);
   info->applet_list = NULL;
+  if (info->applets) g_variant_unref(info->applets);
   g_free(info->srcdir);
 
   g_slice_free(MatePanelAppletFactoryInfo, info);
 }
 
+/* Builds the MatePanelAppletInfo of a factory read from the registry */
+static void mate_panel_applet_factory_info_ensure_applets(
+    MatePanelAppletFactoryInfo *info) {
+  GVariantIter iter;
+  const char *iid;
+  const char *name;
+  const char *comment;
+  const char *icon;
+  const char **old_ids;
+  gboolean x11_supported;
+  gboolean wayland_supported;
+  GList *list = NULL;
+
+  if (!info->applets) return;
+
+  g_variant_iter_init(&iter, info->applets);
+  while (g_variant_iter_next(&iter, "(&sm&sm&sm&s^a&sbb)", &iid, &name,
+                             &comment, &icon, &old_ids, &x11_supported,
+                             &wayland_supported)) {
+    list = g_list_prepend(
+        list, mate_panel_applet_info_new(iid, name, comment, icon, old_ids,
+                                         x11_supported, wayland_supported));
+    g_free(old_ids);
+  }
+
+  info->applet_list = g_list_reverse(list);
+
+  g_variant_unref(info->applets);
+  info->applets = NULL;
+}
+
 static MatePanelAppletInfo *_mate_panel_applets_manager_get_applet_info(
     GKeyFile *applet_file, const gchar *group, const gchar *factory_id) {
   MatePanelAppletInfo *info;
@@ -260,6 +307,194 @@ static GSList *mate_panel_applets_manager_get_applets_dirs(void) {
   return g_slist_reverse(retval);
 }
 
+static char *mate_panel_applets_registry_get_file(void) {
+  return g_build_filename(g_get_user_cache_dir(), "mate-panel",
+                          MATE_PANEL_APPLETS_REGISTRY_FILE, NULL);
+}
+
+static void mate_panel_applets_registry_invalidate(void) {
+  char *filename;
+
+  filename = mate_panel_applets_registry_get_file();
+  g_unlink(filename);
+  g_free(filename);
+}
+
+/* Returns the a(sx) list of the applet directories with their
+ * modification time, -1 for the ones that do not exist */
+static GVariant *mate_panel_applets_registry_get_dirs_stamp(GSList *dirs) {
+  GVariantBuilder builder;
+  GSList *d;
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sx)"));
+  for (d = dirs; d; d = g_slist_next(d)) {
+    GStatBuf buf;
+    gint64 mtime = -1;
+
+    if (g_stat(d->data, &buf) == 0) mtime = buf.st_mtime;
+
+    g_variant_builder_add(&builder, "(sx)", d->data, mtime);
+  }
+
+  return g_variant_ref_sink(g_variant_builder_end(&builder));
+}
+
+static char *mate_panel_applets_registry_get_languages(void) {
+  return g_strjoinv(":", (gchar **)g_get_language_names());
+}
+
+static const char *mate_panel_applets_registry_get_lib_prefix(void) {
+  const char *lib_prefix;
+
+  lib_prefix = g_getenv("MATE_PANEL_APPLET_LIB_PREFIX");
+
+  return lib_prefix ? lib_prefix : "";
+}
+
+static gboolean mate_panel_applets_registry_load(
+    MatePanelAppletsManagerDBus *manager, GVariant *dirs_stamp) {
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *registry;
+  GVariant *cached_stamp;
+  GVariant *factories;
+  GVariant *factory;
+  GVariantIter iter;
+  const char *languages;
+  const char *lib_prefix;
+  char *current_languages;
+  char *filename;
+  guint32 version;
+  gboolean valid;
+
+  filename = mate_panel_applets_registry_get_file();
+  mapped = g_mapped_file_new(filename, FALSE, NULL);
+  g_free(filename);
+
+  if (!mapped) return FALSE;
+
+  bytes = g_mapped_file_get_bytes(mapped);
+  g_mapped_file_unref(mapped);
+
+  registry = g_variant_ref_sink(g_variant_new_from_bytes(
+      G_VARIANT_TYPE(MATE_PANEL_APPLETS_REGISTRY_TYPE), bytes, FALSE));
+  g_bytes_unref(bytes);
+
+  g_variant_get_child(registry, 0, "u", &version);
+  g_variant_get_child(registry, 1, "&s", &languages);
+  g_variant_get_child(registry, 2, "&s", &lib_prefix);
+  cached_stamp = g_variant_get_child_value(registry, 3);
+
+  current_languages = mate_panel_applets_registry_get_languages();
+  valid = version == MATE_PANEL_APPLETS_REGISTRY_VERSION &&
+          g_strcmp0(languages, current_languages) == 0 &&
+          g_strcmp0(lib_prefix,
+                    mate_panel_applets_registry_get_lib_prefix()) == 0 &&
+          g_variant_equal(cached_stamp, dirs_stamp);
+  g_free(current_languages);
+  g_variant_unref(cached_stamp);
+
+  if (!valid) {
+    g_variant_unref(registry);
+    return FALSE;
+  }
+
+  factories = g_variant_get_child_value(registry, 4);
+  g_variant_iter_init(&iter, factories);
+  while ((factory = g_variant_iter_next_value(&iter))) {
+    MatePanelAppletFactoryInfo *info;
+
+    /* the applets are only built when asked for, most of them are never
+     * used by the panel */
+    info = g_slice_new0(MatePanelAppletFactoryInfo);
+    g_variant_get(factory, "(sbmssb@a(smsmsmsasbb))", &info->id,
+                  &info->in_process, &info->location, &info->srcdir,
+                  &info->has_old_ids, &info->applets);
+    g_variant_unref(factory);
+
+    if (g_hash_table_lookup(manager->priv->applet_factories, info->id)) {
+      mate_panel_applet_factory_info_free(info);
+      continue;
+    }
+
+    g_hash_table_insert(manager->priv->applet_factories, g_strdup(info->id),
+                        info);
+  }
+
+  g_variant_unref(factories);
+  g_variant_unref(registry);
+
+  return TRUE;
+}
+
+static void mate_panel_applets_registry_save(
+    MatePanelAppletsManagerDBus *manager, GVariant *dirs_stamp) {
+  GVariantBuilder builder;
+  GVariant *registry;
+  GHashTableIter iter;
+  gpointer value;
+  char *languages;
+  char *filename;
+  char *dirname;
+  GError *error = NULL;
+
+  g_variant_builder_init(
+      &builder, G_VARIANT_TYPE("a" MATE_PANEL_APPLETS_REGISTRY_FACTORY_TYPE));
+
+  g_hash_table_iter_init(&iter, manager->priv->applet_factories);
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    MatePanelAppletFactoryInfo *info = value;
+    GVariantBuilder applets;
+    GList *l;
+
+    g_variant_builder_init(
+        &applets, G_VARIANT_TYPE("a" MATE_PANEL_APPLETS_REGISTRY_APPLET_TYPE));
+
+    for (l = info->applet_list; l; l = g_list_next(l)) {
+      MatePanelAppletInfo *ainfo = l->data;
+      const char *const *old_ids;
+      const char *const no_old_ids[] = {NULL};
+
+      old_ids = mate_panel_applet_info_get_old_ids(ainfo);
+
+      g_variant_builder_add(
+          &applets, "(smsmsms^asbb)", mate_panel_applet_info_get_iid(ainfo),
+          mate_panel_applet_info_get_name(ainfo),
+          mate_panel_applet_info_get_description(ainfo),
+          mate_panel_applet_info_get_icon(ainfo),
+          old_ids ? old_ids : no_old_ids,
+          mate_panel_applet_info_get_x11_supported(ainfo),
+          mate_panel_applet_info_get_wayland_supported(ainfo));
+    }
+
+    g_variant_builder_add(&builder, MATE_PANEL_APPLETS_REGISTRY_FACTORY_TYPE,
+                          info->id, info->in_process, info->location,
+                          info->srcdir, info->has_old_ids, &applets);
+  }
+
+  languages = mate_panel_applets_registry_get_languages();
+  registry = g_variant_ref_sink(g_variant_new(
+      "(uss@a(sx)a" MATE_PANEL_APPLETS_REGISTRY_FACTORY_TYPE ")",
+      MATE_PANEL_APPLETS_REGISTRY_VERSION, languages,
+      mate_panel_applets_registry_get_lib_prefix(), dirs_stamp, &builder));
+  g_free(languages);
+
+  filename = mate_panel_applets_registry_get_file();
+  dirname = g_path_get_dirname(filename);
+
+  if (g_mkdir_with_parents(dirname, 0700) != 0 ||
+      !g_file_set_contents(filename, g_variant_get_data(registry),
+                           g_variant_get_size(registry), &error)) {
+    g_warning("Cannot save the applets registry to '%s': %s", filename,
+              error ? error->message : g_strerror(errno));
+    g_clear_error(&error);
+  }
+
+  g_free(dirname);
+  g_free(filename);
+  g_variant_unref(registry);
+}
+
 static void applets_directory_changed(GFileMonitor *monitor, GFile *file,
                                       GFile *other_file,
                                       GFileMonitorEvent event_type,
@@ -281,6 +516,10 @@ static void applets_directory_changed(GFileMonitor *monitor, GFile *file,
         return;
       }
 
+      /* an applet file might be modified in place, without changing
+       * the modification time of its directory */
+      mate_panel_applets_registry_invalidate();
+
       info = mate_panel_applets_manager_get_applet_factory_info_from_file(
           filename);
       g_free(filename);
@@ -327,66 +566,91 @@ static void applets_directory_changed(GFileMonitor *monitor, GFile *file,
   }
 }
 
-static void mate_panel_applets_manager_dbus_load_applet_infos(
-    MatePanelAppletsManagerDBus *manager) {
-  GSList *dirs, *d;
+static void mate_panel_applets_manager_dbus_monitor_dir(
+    MatePanelAppletsManagerDBus *manager, const gchar *path) {
+  GFileMonitor *monitor;
+  GFile *dir_file;
+
+  dir_file = g_file_new_for_path(path);
+  monitor = g_file_monitor_directory(dir_file, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (monitor) {
+    g_signal_connect(monitor, "changed", G_CALLBACK(applets_directory_changed),
+                     manager);
+    manager->priv->monitors = g_list_prepend(manager->priv->monitors, monitor);
+  }
+  g_object_unref(dir_file);
+}
+
+static void mate_panel_applets_manager_dbus_read_applets_dir(
+    MatePanelAppletsManagerDBus *manager, const gchar *path) {
   GDir *dir;
   const gchar *dirent;
   GError *error = NULL;
 
-  dirs = mate_panel_applets_manager_get_applets_dirs();
-  for (d = dirs; d; d = g_slist_next(d)) {
-    GFileMonitor *monitor;
-    GFile *dir_file;
-    gchar *path = (gchar *)d->data;
+  dir = g_dir_open(path, 0, &error);
+  if (!dir) {
+    g_warning("%s", error->message);
+    g_error_free(error);
 
-    dir = g_dir_open(path, 0, &error);
-    if (!dir) {
-      g_warning("%s", error->message);
-      g_error_free(error);
-      g_free(path);
+    return;
+  }
 
+  while ((dirent = g_dir_read_name(dir))) {
+    MatePanelAppletFactoryInfo *info;
+    gchar *file;
+
+    if (!g_str_has_suffix(dirent, MATE_PANEL_APPLETS_EXTENSION)) continue;
+
+    file = g_build_filename(path, dirent, NULL);
+    info = mate_panel_applets_manager_get_applet_factory_info_from_file(file);
+    g_free(file);
+
+    if (!info) continue;
+
+    if (g_hash_table_lookup(manager->priv->applet_factories, info->id)) {
+      mate_panel_applet_factory_info_free(info);
       continue;
     }
 
-    /* Monitor dir */
-    dir_file = g_file_new_for_path(path);
-    monitor =
-        g_file_monitor_directory(dir_file, G_FILE_MONITOR_NONE, NULL, NULL);
-    if (monitor) {
-      g_signal_connect(monitor, "changed",
-                       G_CALLBACK(applets_directory_changed), manager);
-      manager->priv->monitors =
-          g_list_prepend(manager->priv->monitors, monitor);
-    }
-    g_object_unref(dir_file);
+    g_hash_table_insert(manager->priv->applet_factories, g_strdup(info->id),
+                        info);
+  }
 
-    while ((dirent = g_dir_read_name(dir))) {
-      MatePanelAppletFactoryInfo *info;
-      gchar *file;
+  g_dir_close(dir);
+}
 
-      if (!g_str_has_suffix(dirent, MATE_PANEL_APPLETS_EXTENSION)) continue;
+static void mate_panel_applets_manager_dbus_load_applet_infos(
+    MatePanelAppletsManagerDBus *manager) {
+  GSList *dirs, *d;
+  GVariant *dirs_stamp;
+  gboolean from_registry;
 
-      file = g_build_filename(path, dirent, NULL);
-      info = mate_panel_applets_manager_get_applet_factory_info_from_file(file);
-      g_free(file);
+  dirs = mate_panel_applets_manager_get_applets_dirs();
 
-      if (!info) continue;
+  /* stat the directories before reading them, so that a change happening
+   * meanwhile invalidates the registry we write */
+  dirs_stamp = mate_panel_applets_registry_get_dirs_stamp(dirs);
 
-      if (g_hash_table_lookup(manager->priv->applet_factories, info->id)) {
-        mate_panel_applet_factory_info_free(info);
-        continue;
-      }
+  panel_trace_begin("load-applet-infos", NULL);
 
-      g_hash_table_insert(manager->priv->applet_factories, g_strdup(info->id),
-                          info);
-    }
+  from_registry = mate_panel_applets_registry_load(manager, dirs_stamp);
+
+  for (d = dirs; d; d = g_slist_next(d)) {
+    gchar *path = (gchar *)d->data;
 
-    g_dir_close(dir);
-    g_free(path);
+    if (!from_registry)
+      mate_panel_applets_manager_dbus_read_applets_dir(manager, path);
+
+    if (g_file_test(path, G_FILE_TEST_IS_DIR))
+      mate_panel_applets_manager_dbus_monitor_dir(manager, path);
   }
 
-  g_slist_free(dirs);
+  if (!from_registry) mate_panel_applets_registry_save(manager, dirs_stamp);
+
+  panel_trace_end("load-applet-infos");
+
+  g_variant_unref(dirs_stamp);
+  g_slist_free_full(dirs, g_free);
 }
 
 static GList *mate_panel_applets_manager_dbus_get_applets(
@@ -403,6 +667,7 @@ static GList *mate_panel_applets_manager_dbus_get_applets(
     MatePanelAppletFactoryInfo *info;
 
     info = (MatePanelAppletFactoryInfo *)value;
+    mate_panel_applet_factory_info_ensure_applets(info);
     retval = g_list_concat(retval, g_list_copy(info->applet_list));
   }
 
@@ -434,10 +699,13 @@ static gboolean mate_panel_applets_manager_dbus_factory_activate(
   MatePanelAppletInfo *applet_info;
   ActivateAppletFunc activate_applet;
   GetAppletWidgetFunc get_applet_widget;
+  int retval;
 
   info = get_applet_factory_info(manager, iid);
   if (!info) return FALSE;
 
+  panel_trace_instant("factory-activate", iid);
+
   applet_info = MATE_PANEL_APPLETS_MANAGER_GET_CLASS(manager)->get_applet_info(
       manager, iid);
   g_return_val_if_fail(applet_info, FALSE);
@@ -471,7 +739,9 @@ static gboolean mate_panel_applets_manager_dbus_factory_activate(
     return TRUE;
   }
 
+  panel_trace_begin("factory-module-open", info->location);
   info->module = g_module_open(info->location, G_MODULE_BIND_LAZY);
+  panel_trace_end("factory-module-open");
   if (!info->module) {
     /* FIXME: use a GError? */
     g_warning("Failed to load applet %s: %s\n", iid, g_module_error());
@@ -499,7 +769,10 @@ static gboolean mate_panel_applets_manager_dbus_factory_activate(
   }
 
   /* Activate the applet */
-  if (activate_applet() != 0) {
+  panel_trace_begin("factory-init", iid);
+  retval = activate_applet();
+  panel_trace_end("factory-init");
+  if (retval != 0) {
     /* FIXME: use a GError? */
     g_warning("Failed to load applet %s\n", iid);
     g_module_close(info->module);
@@ -544,6 +817,8 @@ static MatePanelAppletInfo *mate_panel_applets_manager_dbus_get_applet_info(
   info = get_applet_factory_info(manager, iid);
   if (!info) return NULL;
 
+  mate_panel_applet_factory_info_ensure_applets(info);
+
   for (l = info->applet_list; l; l = g_list_next(l)) {
     MatePanelAppletInfo *ainfo = (MatePanelAppletInfo *)l->data;
 
@@ -571,6 +846,8 @@ mate_panel_applets_manager_dbus_get_applet_info_from_old_id(
     info = (MatePanelAppletFactoryInfo *)value;
     if (!info->has_old_ids) continue;
 
+    mate_panel_applet_factory_info_ensure_applets(info);
+
     for (l = info->applet_list; l; l = g_list_next(l)) {
       MatePanelAppletInfo *ainfo;
       gint i = 0;
@@ -142,3 +142,22 @@ const char *panel_g_utf8_strstrcase(const char *haystack, const char *needle) {
 
   return NULL;
 }
+
+/* Returns a normalized, case-folded copy of str, suitable for repeated
+ * case-insensitive matching with strstr(). Folding once up front is much
+ * cheaper than calling panel_g_utf8_strstrcase() on the same strings for
+ * each new needle. */
+char *panel_g_utf8_fold(const char *str) {
+  char *normalized;
+  char *folded;
+
+  if (str == NULL) return NULL;
+
+  normalized = g_utf8_normalize(str, -1, G_NORMALIZE_ALL);
+  if (normalized == NULL) return NULL;
+
+  folded = g_utf8_casefold(normalized, -1);
+  g_free(normalized);
+
+  return folded;
+}
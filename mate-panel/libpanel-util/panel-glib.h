@@ -36,6 +36,7 @@ char *panel_g_lookup_in_data_dirs(const char *basename);
 char *panel_g_lookup_in_applications_dirs(const char *basename);
 
 const char *panel_g_utf8_strstrcase(const char *haystack, const char *needle);
+char *panel_g_utf8_fold(const char *str);
 
 G_END_DECLS
 
@@ -0,0 +1,180 @@
+/*
+ * panel-trace.c: startup timeline tracing
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "panel-trace.h"
+
+#include <unistd.h>
+
+/* Events are kept in memory, as Chrome trace event format JSON objects,
+ * and written out by panel_trace_write(). The resulting file can be
+ * opened in chrome://tracing or https://ui.perfetto.dev. Timestamps are
+ * in microseconds of the monotonic clock.
+ *
+ * All the functions do nothing unless panel_trace_init() was called with
+ * a file name, so they are cheap to leave in place. */
+
+static char *trace_filename = NULL;
+static GString *trace_events = NULL;
+static GMutex trace_mutex;
+
+/* Small, stable ids for the threads emitting events, 1 being the first */
+static gint trace_last_tid = 0;
+static GPrivate trace_tid;
+
+static int panel_trace_get_tid(void) {
+  int tid = GPOINTER_TO_INT(g_private_get(&trace_tid));
+
+  if (tid == 0) {
+    tid = g_atomic_int_add(&trace_last_tid, 1) + 1;
+    g_private_set(&trace_tid, GINT_TO_POINTER(tid));
+  }
+
+  return tid;
+}
+
+void panel_trace_init(const char *filename) {
+  if (!filename || !filename[0] || trace_filename) return;
+
+  trace_filename = g_strdup(filename);
+  trace_events = g_string_new(NULL);
+}
+
+gboolean panel_trace_is_enabled(void) { return trace_filename != NULL; }
+
+static void panel_trace_append_json_string(GString *str, const char *value) {
+  const char *p;
+
+  g_string_append_c(str, '"');
+  for (p = value; *p; p++) {
+    switch (*p) {
+      case '"':
+        g_string_append(str, "\\\"");
+        break;
+      case '\\':
+        g_string_append(str, "\\\\");
+        break;
+      default:
+        if ((guchar)*p < 0x20)
+          g_string_append_printf(str, "\\u%04x", (guchar)*p);
+        else
+          g_string_append_c(str, *p);
+        break;
+    }
+  }
+  g_string_append_c(str, '"');
+}
+
+static void panel_trace_add_event(const char *phase, const char *name,
+                                  const char *id, const char *arg) {
+  gint64 now;
+
+  if (!trace_events) return;
+
+  now = g_get_monotonic_time();
+
+  g_mutex_lock(&trace_mutex);
+
+  if (trace_events->len > 0) g_string_append(trace_events, ",\n");
+
+  g_string_append(trace_events, "{\"name\":");
+  panel_trace_append_json_string(trace_events, name);
+  g_string_append_printf(trace_events,
+                         ",\"cat\":\"mate-panel\",\"ph\":\"%s\","
+                         "\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d",
+                         phase, now, (int)getpid(), panel_trace_get_tid());
+
+  if (id) {
+    g_string_append(trace_events, ",\"id\":");
+    panel_trace_append_json_string(trace_events, id);
+  }
+
+  if (arg && phase[0] == 'C') {
+    g_string_append_printf(trace_events, ",\"args\":{\"value\":%s}", arg);
+  } else if (arg) {
+    g_string_append(trace_events, ",\"args\":{\"detail\":");
+    panel_trace_append_json_string(trace_events, arg);
+    g_string_append_c(trace_events, '}');
+  }
+
+  if (phase[0] == 'i') g_string_append(trace_events, ",\"s\":\"p\"");
+
+  g_string_append_c(trace_events, '}');
+
+  g_mutex_unlock(&trace_mutex);
+}
+
+/* Synchronous phases, they must be properly nested */
+void panel_trace_begin(const char *name, const char *arg) {
+  panel_trace_add_event("B", name, NULL, arg);
+}
+
+void panel_trace_end(const char *name) {
+  panel_trace_add_event("E", name, NULL, NULL);
+}
+
+/* Asynchronous operations, which may overlap: the begin and end events
+ * are matched by name and id */
+void panel_trace_async_begin(const char *name, const char *id) {
+  panel_trace_add_event("b", name, id, NULL);
+}
+
+void panel_trace_async_end(const char *name, const char *id) {
+  panel_trace_add_event("e", name, id, NULL);
+}
+
+void panel_trace_instant(const char *name, const char *arg) {
+  panel_trace_add_event("i", name, NULL, arg);
+}
+
+/* A value over time, drawn as a graph by the trace viewers */
+void panel_trace_counter(const char *name, gint64 value) {
+  char arg[32];
+
+  if (!trace_events) return;
+
+  g_snprintf(arg, sizeof(arg), "%" G_GINT64_FORMAT, value);
+  panel_trace_add_event("C", name, NULL, arg);
+}
+
+/* Writes all the events recorded so far; can be called several times */
+void panel_trace_write(void) {
+  GString *contents;
+  GError *error = NULL;
+
+  if (!trace_events) return;
+
+  contents = g_string_new("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  g_mutex_lock(&trace_mutex);
+  g_string_append_len(contents, trace_events->str, trace_events->len);
+  g_mutex_unlock(&trace_mutex);
+
+  g_string_append(contents, "\n]}\n");
+
+  if (!g_file_set_contents(trace_filename, contents->str, contents->len,
+                           &error)) {
+    g_warning("Cannot write trace file '%s': %s", trace_filename,
+              error->message);
+    g_error_free(error);
+  }
+
+  g_string_free(contents, TRUE);
+}
@@ -24,6 +24,7 @@
 #include <libegg/eggsmclient.h>
 #include <libpanel-util/panel-cleanup.h>
 #include <libpanel-util/panel-glib.h>
+#include <libpanel-util/panel-trace.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/wait.h>
@@ -57,6 +58,7 @@ static char *layout;
 static gboolean replace = FALSE;
 static gboolean reset = FALSE;
 static gboolean run_dialog = FALSE;
+static char *trace_file = NULL;
 
 static const GOptionEntry options[] = {
     {"replace", 0, 0, G_OPTION_ARG_NONE, &replace,
@@ -70,6 +72,9 @@ static const GOptionEntry options[] = {
     /* default panels layout */
     {"layout", 0, 0, G_OPTION_ARG_STRING, &layout,
      N_("Set the default panel layout"), NULL},
+    /* startup timeline, also enabled by $MATE_PANEL_TRACE */
+    {"trace", 0, 0, G_OPTION_ARG_FILENAME, &trace_file,
+     N_("Write a startup timeline to FILE"), N_("FILE")},
     {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}};
 
 static void parsing_error_cb(GtkCssProvider *provider, GtkCssSection *section,
@@ -133,6 +138,10 @@ int main(int argc, char **argv) {
 
   g_option_context_free(context);
 
+  if (!trace_file) trace_file = g_strdup(g_getenv(PANEL_TRACE_ENV));
+  panel_trace_init(trace_file);
+  panel_trace_instant("main", NULL);
+
   /* set the default layout */
   if (layout != NULL && layout[0] != 0) {
     GSettings *settings;
@@ -187,7 +196,10 @@ int main(int argc, char **argv) {
 
   panel_global_config_load();
   panel_lockdown_init();
+
+  panel_trace_begin("profile-load", NULL);
   panel_profile_load();
+  panel_trace_end("profile-load");
 
   /*add forbidden lists to ALL panels*/
   g_slist_foreach(panels, (GFunc)panel_widget_add_forbidden, NULL);
@@ -221,6 +233,10 @@ int main(int argc, char **argv) {
 
   g_object_unref(provider);
 
+  /* also keep what happened after the initial unhide */
+  if (panel_trace_is_enabled())
+    panel_cleanup_register(PANEL_CLEAN_FUNC(panel_trace_write), NULL);
+
   gtk_main();
 
   panel_lockdown_finalize();
@@ -721,6 +721,96 @@ void setup_internal_applet_drag(GtkWidget *menuitem,
   g_signal_connect(menuitem, "drag-end", G_CALLBACK(drag_end_menu_cb), NULL);
 }
 
+static void menu_signature_append_icon(GString *signature, GIcon *icon) {
+  char *icon_string = icon ? g_icon_to_string(icon) : NULL;
+
+  g_string_append_printf(signature, "%s\037", icon_string ? icon_string : "");
+  g_free(icon_string);
+}
+
+static void menu_signature_append_directory(GString *signature,
+                                            MateMenuTreeDirectory *directory) {
+  g_string_append_printf(
+      signature, "%s\037%s\037",
+      sure_string(matemenu_tree_directory_get_name(directory)),
+      sure_string(matemenu_tree_directory_get_comment(directory)));
+  menu_signature_append_icon(signature,
+                             matemenu_tree_directory_get_icon(directory));
+}
+
+static void menu_signature_append_entry(GString *signature,
+                                        MateMenuTreeEntry *entry) {
+  GDesktopAppInfo *ginfo = matemenu_tree_entry_get_app_info(entry);
+
+  g_string_append_printf(
+      signature, "%s\037%s\037%s\037%s\037",
+      sure_string(matemenu_tree_entry_get_desktop_file_path(entry)),
+      sure_string(g_app_info_get_name(G_APP_INFO(ginfo))),
+      sure_string(g_app_info_get_description(G_APP_INFO(ginfo))),
+      sure_string(g_desktop_app_info_get_generic_name(ginfo)));
+  menu_signature_append_icon(signature, g_app_info_get_icon(G_APP_INFO(ginfo)));
+}
+
+/* Describes everything populate_menu_from_directory () shows of a
+ * directory, not including the content of its subdirectories: when a tree
+ * is reloaded, a menu is only rebuilt if its signature changed. */
+static char *menu_directory_get_signature(MateMenuTreeDirectory *directory) {
+  GString *signature;
+  MateMenuTreeIter *iter;
+  MateMenuTreeItemType type;
+
+  signature = g_string_new(NULL);
+
+  iter = matemenu_tree_directory_iter(directory);
+  while ((type = matemenu_tree_iter_next(iter)) != MATEMENU_TREE_ITEM_INVALID) {
+    gpointer item, aliased;
+
+    g_string_append_printf(signature, "%d\036", type);
+
+    switch (type) {
+      case MATEMENU_TREE_ITEM_DIRECTORY:
+        item = matemenu_tree_iter_get_directory(iter);
+        menu_signature_append_directory(signature, item);
+        matemenu_tree_item_unref(item);
+        break;
+
+      case MATEMENU_TREE_ITEM_ENTRY:
+        item = matemenu_tree_iter_get_entry(iter);
+        menu_signature_append_entry(signature, item);
+        matemenu_tree_item_unref(item);
+        break;
+
+      case MATEMENU_TREE_ITEM_ALIAS:
+        item = matemenu_tree_iter_get_alias(iter);
+        aliased = matemenu_tree_alias_get_directory(item);
+        menu_signature_append_directory(signature, aliased);
+        matemenu_tree_item_unref(aliased);
+        if (matemenu_tree_alias_get_aliased_item_type(item) ==
+            MATEMENU_TREE_ITEM_ENTRY) {
+          aliased = matemenu_tree_alias_get_aliased_entry(item);
+          menu_signature_append_entry(signature, aliased);
+          matemenu_tree_item_unref(aliased);
+        }
+        matemenu_tree_item_unref(item);
+        break;
+
+      case MATEMENU_TREE_ITEM_HEADER:
+        item = matemenu_tree_iter_get_header(iter);
+        aliased = matemenu_tree_header_get_directory(item);
+        menu_signature_append_directory(signature, aliased);
+        matemenu_tree_item_unref(aliased);
+        matemenu_tree_item_unref(item);
+        break;
+
+      default:
+        break;
+    }
+  }
+  matemenu_tree_iter_unref(iter);
+
+  return g_string_free(signature, FALSE);
+}
+
 static void submenu_to_display(GtkWidget *menu) {
   void (*append_callback)(GtkWidget *, gpointer);
   gpointer append_data;
@@ -745,7 +835,11 @@ static void submenu_to_display(GtkWidget *menu) {
                            directory, (GDestroyNotify)matemenu_tree_item_unref);
   }
 
-  if (directory) populate_menu_from_directory(menu, directory);
+  if (directory) {
+    populate_menu_from_directory(menu, directory);
+    g_object_set_data_full(G_OBJECT(menu), "panel-menu-signature",
+                           menu_directory_get_signature(directory), g_free);
+  }
 
   append_callback =
       g_object_get_data(G_OBJECT(menu), "panel-menu-append-callback");
@@ -770,26 +864,36 @@ static void remove_submenu_to_display_idle(gpointer data) {
   g_source_remove(idle_id);
 }
 
+/* The menu gets populated when shown, or before that in idle time */
+static void menu_schedule_loading(GtkWidget *menu) {
+  guint idle_id;
+
+  g_object_set_data(G_OBJECT(menu), "panel-menu-needs-loading",
+                    GUINT_TO_POINTER(TRUE));
+
+  idle_id =
+      g_idle_add_full(G_PRIORITY_LOW, submenu_to_display_in_idle, menu, NULL);
+  g_object_set_data_full(G_OBJECT(menu), "panel-menu-idle-id",
+                         GUINT_TO_POINTER(idle_id),
+                         remove_submenu_to_display_idle);
+}
+
 static GtkWidget *create_fake_menu(MateMenuTreeDirectory *directory) {
   GtkWidget *menu;
-  guint idle_id;
 
   menu = create_empty_menu();
 
   g_object_set_data_full(G_OBJECT(menu), "panel-menu-tree-directory",
                          matemenu_tree_item_ref(directory),
                          (GDestroyNotify)matemenu_tree_item_unref);
-
-  g_object_set_data(G_OBJECT(menu), "panel-menu-needs-loading",
-                    GUINT_TO_POINTER(TRUE));
+  /* to find the directory again in a reloaded tree */
+  g_object_set_data_full(G_OBJECT(menu), "panel-menu-tree-path",
+                         matemenu_tree_directory_make_path(directory, NULL),
+                         (GDestroyNotify)g_free);
 
   g_signal_connect(menu, "show", G_CALLBACK(submenu_to_display), NULL);
 
-  idle_id =
-      g_idle_add_full(G_PRIORITY_LOW, submenu_to_display_in_idle, menu, NULL);
-  g_object_set_data_full(G_OBJECT(menu), "panel-menu-idle-id",
-                         GUINT_TO_POINTER(idle_id),
-                         remove_submenu_to_display_idle);
+  menu_schedule_loading(menu);
 
   g_signal_connect(menu, "button-press-event",
                    G_CALLBACK(menu_dummy_button_press_event), NULL);
@@ -980,36 +1084,162 @@ static void create_menuitem_from_alias(GtkWidget *menu,
   }
 }
 
-static void handle_matemenu_tree_changed(MateMenuTree *tree, GtkWidget *menu) {
+/* Rebuilds the menus of a reloaded tree whose content changed; the others,
+ * and their submenus that are not rebuilt, are just pointed to the new
+ * directories. */
+static void menu_refresh(GtkWidget *menu, MateMenuTree *tree,
+                         MateMenuTreeDirectory *directory) {
+  GList *children, *l;
+  char *signature;
+
+  if (g_object_get_data(G_OBJECT(menu), "panel-menu-needs-loading")) {
+    g_object_set_data_full(
+        G_OBJECT(menu), "panel-menu-tree-directory",
+        directory ? matemenu_tree_item_ref(directory) : NULL,
+        (GDestroyNotify)matemenu_tree_item_unref);
+    return;
+  }
+
+  signature = directory ? menu_directory_get_signature(directory) : NULL;
+  if (!signature ||
+      g_strcmp0(signature, g_object_get_data(G_OBJECT(menu),
+                                             "panel-menu-signature")) != 0) {
+    children = gtk_container_get_children(GTK_CONTAINER(menu));
+    for (l = children; l; l = l->next) gtk_widget_destroy(l->data);
+    g_list_free(children);
+
+    g_object_set_data_full(
+        G_OBJECT(menu), "panel-menu-tree-directory",
+        directory ? matemenu_tree_item_ref(directory) : NULL,
+        (GDestroyNotify)matemenu_tree_item_unref);
+    g_object_set_data(G_OBJECT(menu), "panel-menu-signature", NULL);
+    g_free(signature);
+
+    menu_schedule_loading(menu);
+    return;
+  }
+
+  g_free(signature);
+
+  g_object_set_data_full(G_OBJECT(menu), "panel-menu-tree-directory",
+                         matemenu_tree_item_ref(directory),
+                         (GDestroyNotify)matemenu_tree_item_unref);
+
+  children = gtk_container_get_children(GTK_CONTAINER(menu));
+  for (l = children; l; l = l->next) {
+    MateMenuTreeDirectory *subdirectory;
+    GtkWidget *submenu;
+    const char *path;
+
+    if (!GTK_IS_MENU_ITEM(l->data)) continue;
+
+    submenu = gtk_menu_item_get_submenu(GTK_MENU_ITEM(l->data));
+    if (!submenu) continue;
+
+    path = g_object_get_data(G_OBJECT(submenu), "panel-menu-tree-path");
+    if (!path) continue;
+
+    subdirectory = matemenu_tree_get_directory_from_path(tree, path);
+    menu_refresh(submenu, tree, subdirectory);
+    if (subdirectory) matemenu_tree_item_unref(subdirectory);
+  }
+  g_list_free(children);
+}
+
+/* Menu trees are shared by all the menus showing the same menu file. A
+ * change to the menu or desktop files comes in bursts (think of a package
+ * upgrade), so the tree is only reloaded once they stopped for a while. */
+#define PANEL_MENU_RELOAD_DELAY 1000
+
+typedef struct {
+  MateMenuTree *tree;
+  char *menu_file;
+  GSList *menus;
+  guint reload_id;
+} PanelMenuTreeInfo;
+
+static GHashTable *menu_trees = NULL;
+
+static void panel_menu_tree_info_free(PanelMenuTreeInfo *info) {
+  g_hash_table_remove(menu_trees, info->menu_file);
+
+  if (info->reload_id) g_source_remove(info->reload_id);
+
+  g_slist_free(info->menus);
+  g_free(info->menu_file);
+  g_free(info);
+}
+
+static gboolean panel_menu_tree_reload(gpointer data) {
+  PanelMenuTreeInfo *info = data;
   GError *error = NULL;
-  guint idle_id;
+  GSList *l;
 
-  GList *list, *l;
-  list = gtk_container_get_children(GTK_CONTAINER(menu));
-  for (l = list; l; l = l->next) gtk_widget_destroy(l->data);
-  g_list_free(list);
+  info->reload_id = 0;
 
-  if (!matemenu_tree_load_sync(tree, &error)) {
+  if (!matemenu_tree_load_sync(info->tree, &error)) {
     g_warning("Menu tree reload got error:%s\n", error->message);
     g_error_free(error);
   }
 
-  g_object_set_data_full(G_OBJECT(menu), "panel-menu-tree-directory", NULL,
-                         NULL);
+  for (l = info->menus; l; l = l->next) {
+    MateMenuTreeDirectory *directory;
+    const char *menu_path;
 
-  g_object_set_data(G_OBJECT(menu), "panel-menu-needs-loading",
-                    GUINT_TO_POINTER(TRUE));
+    menu_path = g_object_get_data(G_OBJECT(l->data), "panel-menu-tree-path");
+    directory = matemenu_tree_get_directory_from_path(info->tree, menu_path);
+    menu_refresh(l->data, info->tree, directory);
+    if (directory) matemenu_tree_item_unref(directory);
+  }
 
-  idle_id =
-      g_idle_add_full(G_PRIORITY_LOW, submenu_to_display_in_idle, menu, NULL);
-  g_object_set_data_full(G_OBJECT(menu), "panel-menu-idle-id",
-                         GUINT_TO_POINTER(idle_id),
-                         remove_submenu_to_display_idle);
+  return G_SOURCE_REMOVE;
+}
+
+static void handle_matemenu_tree_changed(MateMenuTree *tree,
+                                         PanelMenuTreeInfo *info) {
+  if (info->reload_id) g_source_remove(info->reload_id);
+
+  info->reload_id =
+      g_timeout_add(PANEL_MENU_RELOAD_DELAY, panel_menu_tree_reload, info);
+}
+
+static MateMenuTree *panel_menu_tree_get(const char *menu_file) {
+  PanelMenuTreeInfo *info;
+  MateMenuTree *tree;
+  GError *error = NULL;
+
+  if (!menu_trees) menu_trees = g_hash_table_new(g_str_hash, g_str_equal);
+
+  tree = g_hash_table_lookup(menu_trees, menu_file);
+  if (tree) return g_object_ref(tree);
+
+  tree = matemenu_tree_new(menu_file, MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
+  if (!matemenu_tree_load_sync(tree, &error)) {
+    g_warning("Menu tree loading got error:%s\n", error->message);
+    g_error_free(error);
+    g_object_unref(tree);
+    return NULL;
+  }
+
+  info = g_new0(PanelMenuTreeInfo, 1);
+  info->tree = tree;
+  info->menu_file = g_strdup(menu_file);
+
+  g_hash_table_insert(menu_trees, info->menu_file, tree);
+  g_object_set_data_full(G_OBJECT(tree), "panel-menu-tree-info", info,
+                         (GDestroyNotify)panel_menu_tree_info_free);
+
+  g_signal_connect(tree, "changed", G_CALLBACK(handle_matemenu_tree_changed),
+                   info);
+
+  return tree;
 }
 
 static void remove_matemenu_tree_monitor(GtkWidget *menu, MateMenuTree *tree) {
-  g_signal_handlers_disconnect_by_func(
-      tree, G_CALLBACK(handle_matemenu_tree_changed), menu);
+  PanelMenuTreeInfo *info;
+
+  info = g_object_get_data(G_OBJECT(tree), "panel-menu-tree-info");
+  info->menus = g_slist_remove(info->menus, menu);
 }
 
 GtkWidget *create_applications_menu(const char *menu_file,
@@ -1017,8 +1247,6 @@ GtkWidget *create_applications_menu(const char *menu_file,
                                     gboolean always_show_image) {
   MateMenuTree *tree;
   GtkWidget *menu;
-  guint idle_id;
-  GError *error = NULL;
 
   menu = create_empty_menu();
 
@@ -1026,41 +1254,31 @@ GtkWidget *create_applications_menu(const char *menu_file,
     g_object_set_data(G_OBJECT(menu), "panel-menu-force-icon-for-categories",
                       GINT_TO_POINTER(TRUE));
 
-  tree = matemenu_tree_new(menu_file, MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-  if (!matemenu_tree_load_sync(tree, &error)) {
-    g_warning("Menu tree loading got error:%s\n", error->message);
-    g_error_free(error);
-    g_object_unref(tree);
-    tree = NULL;
-  }
+  tree = panel_menu_tree_get(menu_file);
 
-  g_object_set_data_full(G_OBJECT(menu), "panel-menu-tree", g_object_ref(tree),
-                         (GDestroyNotify)g_object_unref);
+  if (tree) {
+    PanelMenuTreeInfo *info;
+
+    g_object_set_data_full(G_OBJECT(menu), "panel-menu-tree", tree,
+                           (GDestroyNotify)g_object_unref);
+
+    info = g_object_get_data(G_OBJECT(tree), "panel-menu-tree-info");
+    info->menus = g_slist_prepend(info->menus, menu);
+    g_signal_connect(menu, "destroy",
+                     G_CALLBACK(remove_matemenu_tree_monitor), tree);
+  }
 
   g_object_set_data_full(G_OBJECT(menu), "panel-menu-tree-path",
                          g_strdup(menu_path ? menu_path : "/"),
                          (GDestroyNotify)g_free);
 
-  g_object_set_data(G_OBJECT(menu), "panel-menu-needs-loading",
-                    GUINT_TO_POINTER(TRUE));
-
   g_signal_connect(menu, "show", G_CALLBACK(submenu_to_display), NULL);
 
-  idle_id =
-      g_idle_add_full(G_PRIORITY_LOW, submenu_to_display_in_idle, menu, NULL);
-  g_object_set_data_full(G_OBJECT(menu), "panel-menu-idle-id",
-                         GUINT_TO_POINTER(idle_id),
-                         remove_submenu_to_display_idle);
+  menu_schedule_loading(menu);
 
   g_signal_connect(menu, "button-press-event",
                    G_CALLBACK(menu_dummy_button_press_event), NULL);
 
-  g_signal_connect(tree, "changed", G_CALLBACK(handle_matemenu_tree_changed),
-                   menu);
-  g_signal_connect(menu, "destroy", G_CALLBACK(remove_matemenu_tree_monitor),
-                   tree);
-
-  g_object_unref(tree);
 
   /*HACK Fix any failures of compiz/other wm's to communicate with gtk for
    * transparency */
@@ -62,6 +62,20 @@
 #include <gdk/gdkwayland.h>
 #endif
 
+/* The search state of one of the two models of the dialog. Each keystroke
+ * extending the text only needs to look at the items that matched before;
+ * the filter function then just checks whether a row is in the matches. */
+typedef struct {
+  /* the searchable item infos of the model */
+  GPtrArray *items;
+  /* the items matching text, or NULL when everything is shown */
+  GHashTable *matches;
+  /* case folded */
+  char *text;
+} PanelAddtoSearch;
+
+typedef struct _PanelAddtoAppIndex PanelAddtoAppIndex;
+
 typedef struct {
   PanelWidget *panel_widget;
 
@@ -79,10 +93,10 @@ typedef struct {
   MateMenuTree *menu_tree;
 
   GSList *applet_list;
-  GSList *application_list;
-  GSList *settings_list;
+  PanelAddtoAppIndex *app_index;
 
-  gchar *search_text;
+  PanelAddtoSearch applet_search;
+  PanelAddtoSearch application_search;
   gchar *applet_search_text;
 
   int insertion_position;
@@ -114,6 +128,8 @@ typedef struct {
   char *iid;
   gboolean enabled;
   gboolean static_data;
+  /* case folded name and description, built on first use */
+  char *search_key;
 } PanelAddtoItemInfo;
 
 typedef struct {
@@ -121,6 +137,23 @@ typedef struct {
   PanelAddtoItemInfo item_info;
 } PanelAddtoAppList;
 
+/* The applications and settings menus are shared by all the dialogs, and
+ * dropped when one of the menu trees changes. A dialog keeps a reference on
+ * the index its model was built from, as the rows point into it. */
+struct _PanelAddtoAppIndex {
+  int ref_count;
+
+  GSList *application_list;
+  GSList *settings_list;
+
+  /* all the item infos of the lists */
+  GPtrArray *items;
+};
+
+static PanelAddtoAppIndex *panel_addto_app_index = NULL;
+static MateMenuTree *panel_addto_applications_tree = NULL;
+static MateMenuTree *panel_addto_settings_tree = NULL;
+
 static PanelAddtoItemInfo special_addto_items[] = {
 
     {PANEL_ADDTO_LAUNCHER_NEW, N_("Custom Application Launcher"),
@@ -167,6 +200,36 @@ static void panel_addto_present_applications(PanelAddtoDialog *dialog);
 static void panel_addto_present_applets(PanelAddtoDialog *dialog);
 static gboolean panel_addto_filter_func(GtkTreeModel *model, GtkTreeIter *iter,
                                         gpointer data);
+static void panel_addto_dialog_free_application_list(GSList *application_list);
+static void panel_addto_search_entry_changed(GtkWidget *entry,
+                                             PanelAddtoDialog *dialog);
+
+/* Search keys and texts are compared with strstr () */
+static char *panel_addto_search_fold(const char *text) {
+  char *folded, *normalized;
+
+  folded = g_utf8_casefold(text, -1);
+  normalized = g_utf8_normalize(folded, -1, G_NORMALIZE_ALL);
+  if (normalized == NULL) return folded;
+
+  g_free(folded);
+
+  return normalized;
+}
+
+static const char *panel_addto_item_info_get_search_key(
+    PanelAddtoItemInfo *info) {
+  char *text;
+
+  if (info->search_key) return info->search_key;
+
+  text = g_strconcat(info->name ? info->name : "", "\n",
+                     info->description ? info->description : "", NULL);
+  info->search_key = panel_addto_search_fold(text);
+  g_free(text);
+
+  return info->search_key;
+}
 
 static int panel_addto_applet_info_sort_func(PanelAddtoItemInfo *a,
                                              PanelAddtoItemInfo *b) {
@@ -384,6 +447,9 @@ static void panel_addto_append_item(PanelAddtoDialog *dialog,
                        applet->name, COLUMN_ENABLED, applet->enabled, -1);
 
     g_free(text);
+
+    panel_addto_item_info_get_search_key(applet);
+    g_ptr_array_add(dialog->applet_search.items, applet);
   }
 }
 
@@ -426,6 +492,7 @@ static void panel_addto_make_applet_model(PanelAddtoDialog *dialog) {
 
   model = gtk_list_store_new(NUMBER_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
                              G_TYPE_POINTER, G_TYPE_STRING, G_TYPE_BOOLEAN);
+  dialog->applet_search.items = g_ptr_array_new();
 
   if (panel_profile_id_lists_are_writable()) {
     panel_addto_append_special_applets(dialog, model);
@@ -440,7 +507,7 @@ static void panel_addto_make_applet_model(PanelAddtoDialog *dialog) {
       gtk_tree_model_filter_new(GTK_TREE_MODEL(dialog->applet_model), NULL);
   gtk_tree_model_filter_set_visible_func(
       GTK_TREE_MODEL_FILTER(dialog->filter_applet_model),
-      panel_addto_filter_func, dialog, NULL);
+      panel_addto_filter_func, &dialog->applet_search, NULL);
 }
 
 static void panel_addto_make_application_list(GSList **parent_list,
@@ -590,45 +657,111 @@ static void panel_addto_populate_application_model(GtkTreeStore *store,
   }
 }
 
-static void panel_addto_make_application_model(PanelAddtoDialog *dialog) {
-  GtkTreeStore *store;
-  MateMenuTree *tree;
+static void panel_addto_app_index_add_items(PanelAddtoAppIndex *index,
+                                            GSList *app_list) {
+  GSList *app;
+
+  for (app = app_list; app != NULL; app = app->next) {
+    PanelAddtoAppList *data = app->data;
+
+    panel_addto_item_info_get_search_key(&data->item_info);
+    g_ptr_array_add(index->items, &data->item_info);
+
+    panel_addto_app_index_add_items(index, data->children);
+  }
+}
+
+static void panel_addto_app_index_unref(PanelAddtoAppIndex *index) {
+  if (--index->ref_count > 0) return;
+
+  panel_addto_dialog_free_application_list(index->application_list);
+  panel_addto_dialog_free_application_list(index->settings_list);
+  g_ptr_array_unref(index->items);
+
+  g_free(index);
+}
+
+static void panel_addto_menu_tree_changed(MateMenuTree *tree) {
+  /* open dialogs keep theirs, the next one gets a new index */
+  g_clear_pointer(&panel_addto_app_index, panel_addto_app_index_unref);
+}
+
+/* Returns FALSE if the menu could not be loaded */
+static gboolean panel_addto_load_menu(MateMenuTree **tree,
+                                      const char *menu_file, GSList **list) {
   MateMenuTreeDirectory *root;
   GError *error = NULL;
 
-  if (dialog->filter_application_model != NULL) return;
-
-  store = gtk_tree_store_new(NUMBER_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
-                             G_TYPE_POINTER, G_TYPE_STRING, G_TYPE_BOOLEAN);
+  if (*tree == NULL) {
+    *tree = matemenu_tree_new(menu_file, MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
+    g_signal_connect(*tree, "changed",
+                     G_CALLBACK(panel_addto_menu_tree_changed), NULL);
+  }
 
-  tree = matemenu_tree_new("mate-applications.menu",
-                           MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-  if (!matemenu_tree_load_sync(tree, &error)) {
-    g_warning("Applications menu tree loading got error:%s\n", error->message);
+  /* (re)loads it after a change */
+  if (!matemenu_tree_load_sync(*tree, &error)) {
+    g_warning("Menu tree %s loading got error:%s\n", menu_file,
+              error->message);
     g_error_free(error);
-    g_clear_object(&tree);
+    g_clear_object(tree);
+    return FALSE;
   }
 
-  if ((root = matemenu_tree_get_root_directory(tree)) != NULL) {
-    panel_addto_make_application_list(&dialog->application_list, root,
-                                      "mate-applications.menu");
-    panel_addto_populate_application_model(store, NULL,
-                                           dialog->application_list);
-
+  if ((root = matemenu_tree_get_root_directory(*tree)) != NULL) {
+    panel_addto_make_application_list(list, root, menu_file);
     matemenu_tree_item_unref(root);
   }
 
-  g_clear_object(&tree);
+  return TRUE;
+}
 
-  tree = matemenu_tree_new("mate-settings.menu",
-                           MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-  if (!matemenu_tree_load_sync(tree, &error)) {
-    g_warning("Settings menu tree loading got error:%s\n", error->message);
-    g_error_free(error);
-    g_clear_object(&tree);
+static PanelAddtoAppIndex *panel_addto_app_index_get(void) {
+  PanelAddtoAppIndex *index;
+  gboolean loaded = TRUE;
+
+  if (panel_addto_app_index) {
+    panel_addto_app_index->ref_count++;
+    return panel_addto_app_index;
+  }
+
+  index = g_new0(PanelAddtoAppIndex, 1);
+  index->ref_count = 1;
+  index->items = g_ptr_array_new();
+
+  if (!panel_addto_load_menu(&panel_addto_applications_tree,
+                             "mate-applications.menu",
+                             &index->application_list))
+    loaded = FALSE;
+  if (!panel_addto_load_menu(&panel_addto_settings_tree, "mate-settings.menu",
+                             &index->settings_list))
+    loaded = FALSE;
+
+  panel_addto_app_index_add_items(index, index->application_list);
+  panel_addto_app_index_add_items(index, index->settings_list);
+
+  /* a menu that failed to load has no monitor telling when to retry */
+  if (loaded) {
+    index->ref_count++;
+    panel_addto_app_index = index;
   }
 
-  if ((root = matemenu_tree_get_root_directory(tree))) {
+  return index;
+}
+
+static void panel_addto_make_application_model(PanelAddtoDialog *dialog) {
+  GtkTreeStore *store;
+
+  if (dialog->filter_application_model != NULL) return;
+
+  store = gtk_tree_store_new(NUMBER_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
+                             G_TYPE_POINTER, G_TYPE_STRING, G_TYPE_BOOLEAN);
+
+  dialog->app_index = panel_addto_app_index_get();
+
+  panel_addto_populate_application_model(store, NULL,
+                                         dialog->app_index->application_list);
+
+  if (dialog->app_index->settings_list) {
     GtkTreeIter iter;
 
     gtk_tree_store_append(store, &iter, NULL);
@@ -636,21 +769,18 @@ static void panel_addto_make_application_model(PanelAddtoDialog *dialog) {
                        COLUMN_DATA, NULL, COLUMN_SEARCH, NULL, COLUMN_ENABLED,
                        TRUE, -1);
 
-    panel_addto_make_application_list(&dialog->settings_list, root,
-                                      "mate-settings.menu");
-    panel_addto_populate_application_model(store, NULL, dialog->settings_list);
-
-    matemenu_tree_item_unref(root);
+    panel_addto_populate_application_model(store, NULL,
+                                           dialog->app_index->settings_list);
   }
 
-  g_object_unref(tree);
+  dialog->application_search.items = g_ptr_array_ref(dialog->app_index->items);
 
   dialog->application_model = GTK_TREE_MODEL(store);
   dialog->filter_application_model = gtk_tree_model_filter_new(
       GTK_TREE_MODEL(dialog->application_model), NULL);
   gtk_tree_model_filter_set_visible_func(
       GTK_TREE_MODEL_FILTER(dialog->filter_application_model),
-      panel_addto_filter_func, dialog, NULL);
+      panel_addto_filter_func, &dialog->application_search, NULL);
 }
 
 static void panel_addto_add_item(PanelAddtoDialog *dialog,
@@ -768,6 +898,8 @@ static void panel_addto_present_applications(PanelAddtoDialog *dialog) {
       g_strdup(gtk_entry_get_text(GTK_ENTRY(dialog->search_entry)));
   /* show everything */
   gtk_entry_set_text(GTK_ENTRY(dialog->search_entry), "");
+  /* in case the entry was already empty */
+  panel_addto_search_entry_changed(dialog->search_entry, dialog);
 }
 
 static void panel_addto_present_applets(PanelAddtoDialog *dialog) {
@@ -784,6 +916,8 @@ static void panel_addto_present_applets(PanelAddtoDialog *dialog) {
     gtk_editable_set_position(GTK_EDITABLE(dialog->search_entry), -1);
     g_clear_pointer(&dialog->applet_search_text, g_free);
   }
+
+  panel_addto_search_entry_changed(dialog->search_entry, dialog);
 }
 
 static void panel_addto_dialog_free_item_info(PanelAddtoItemInfo *item_info) {
@@ -796,6 +930,7 @@ static void panel_addto_dialog_free_item_info(PanelAddtoItemInfo *item_info) {
   g_clear_pointer(&item_info->launcher_path, g_free);
   g_clear_pointer(&item_info->menu_filename, g_free);
   g_clear_pointer(&item_info->menu_path, g_free);
+  g_clear_pointer(&item_info->search_key, g_free);
 }
 
 static void panel_addto_dialog_free_application_list(GSList *application_list) {
@@ -818,6 +953,12 @@ static void panel_addto_dialog_free_application_list(GSList *application_list) {
 static void panel_addto_name_notify(GSettings *settings, gchar *key,
                                     PanelAddtoDialog *dialog);
 
+static void panel_addto_search_clear(PanelAddtoSearch *search) {
+  g_clear_pointer(&search->items, g_ptr_array_unref);
+  g_clear_pointer(&search->matches, g_hash_table_destroy);
+  g_clear_pointer(&search->text, g_free);
+}
+
 static void panel_addto_dialog_free(PanelAddtoDialog *dialog) {
   GSList *item;
 
@@ -825,7 +966,8 @@ static void panel_addto_dialog_free(PanelAddtoDialog *dialog) {
                                        G_CALLBACK(panel_addto_name_notify),
                                        dialog);
 
-  g_free(dialog->search_text);
+  panel_addto_search_clear(&dialog->applet_search);
+  panel_addto_search_clear(&dialog->application_search);
   g_free(dialog->applet_search_text);
 
   if (dialog->addto_dialog) gtk_widget_destroy(dialog->addto_dialog);
@@ -842,8 +984,7 @@ static void panel_addto_dialog_free(PanelAddtoDialog *dialog) {
   }
   g_slist_free(dialog->applet_list);
 
-  panel_addto_dialog_free_application_list(dialog->application_list);
-  panel_addto_dialog_free_application_list(dialog->settings_list);
+  g_clear_pointer(&dialog->app_index, panel_addto_app_index_unref);
 
   g_clear_object(&dialog->filter_applet_model);
   g_clear_object(&dialog->applet_model);
@@ -890,12 +1031,12 @@ static void panel_addto_name_notify(GSettings *settings, gchar *key,
 
 static gboolean panel_addto_filter_func(GtkTreeModel *model, GtkTreeIter *iter,
                                         gpointer userdata) {
-  PanelAddtoDialog *dialog;
+  PanelAddtoSearch *search;
   PanelAddtoItemInfo *data;
 
-  dialog = (PanelAddtoDialog *)userdata;
+  search = (PanelAddtoSearch *)userdata;
 
-  if (!dialog->search_text || !dialog->search_text[0]) return TRUE;
+  if (search->matches == NULL) return TRUE;
 
   gtk_tree_model_get(model, iter, COLUMN_DATA, &data, -1);
 
@@ -907,31 +1048,81 @@ static gboolean panel_addto_filter_func(GtkTreeModel *model, GtkTreeIter *iter,
       gtk_tree_store_iter_depth(GTK_TREE_STORE(model), iter) == 0)
     return TRUE;
 
-  return (panel_g_utf8_strstrcase(data->name, dialog->search_text) != NULL ||
-          panel_g_utf8_strstrcase(data->description, dialog->search_text) !=
-              NULL);
+  return g_hash_table_contains(search->matches, data);
+}
+
+static gboolean panel_addto_search_item_matches(PanelAddtoItemInfo *info,
+                                                const char *text) {
+  return strstr(info->search_key, text) != NULL;
+}
+
+static gboolean panel_addto_search_item_unmatches(gpointer key, gpointer value,
+                                                  gpointer text) {
+  return !panel_addto_search_item_matches(key, text);
+}
+
+/* Returns FALSE if text is the one the matches are already for */
+static gboolean panel_addto_search_set_text(PanelAddtoSearch *search,
+                                            char *text) {
+  guint i;
+
+  if (g_strcmp0(search->text, text) == 0) {
+    g_free(text);
+    return FALSE;
+  }
+
+  if (text[0] == '\0') {
+    g_clear_pointer(&search->matches, g_hash_table_destroy);
+  } else if (search->matches && g_str_has_prefix(text, search->text)) {
+    /* only the previous matches can still match */
+    g_hash_table_foreach_remove(search->matches,
+                                panel_addto_search_item_unmatches, text);
+  } else {
+    if (search->matches)
+      g_hash_table_remove_all(search->matches);
+    else
+      search->matches = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    for (i = 0; i < search->items->len; i++) {
+      PanelAddtoItemInfo *info = g_ptr_array_index(search->items, i);
+
+      if (panel_addto_search_item_matches(info, text))
+        g_hash_table_add(search->matches, info);
+    }
+  }
+
+  g_free(search->text);
+  search->text = text;
+
+  return TRUE;
 }
 
 static void panel_addto_search_entry_changed(GtkWidget *entry,
                                              PanelAddtoDialog *dialog) {
   GtkTreeModel *model;
+  PanelAddtoSearch *search;
   char *new_text;
+  gboolean changed;
   GtkTreeIter iter;
   GtkTreePath *path;
 
+  model = gtk_tree_view_get_model(GTK_TREE_VIEW(dialog->tree_view));
+  if (model == NULL) return;
+
+  if (model == dialog->filter_applet_model)
+    search = &dialog->applet_search;
+  else
+    search = &dialog->application_search;
+
   new_text = g_strdup(gtk_entry_get_text(GTK_ENTRY(dialog->search_entry)));
   g_strchomp(new_text);
 
-  if (dialog->search_text &&
-      g_utf8_collate(new_text, dialog->search_text) == 0) {
-    g_free(new_text);
-    return;
-  }
+  changed =
+      panel_addto_search_set_text(search, panel_addto_search_fold(new_text));
+  g_free(new_text);
 
-  g_free(dialog->search_text);
-  dialog->search_text = new_text;
+  if (!changed) return;
 
-  model = gtk_tree_view_get_model(GTK_TREE_VIEW(dialog->tree_view));
   gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(model));
 
   path = gtk_tree_path_new_first();
@@ -41,6 +41,19 @@
 
 #include "panel-util.h"
 
+/* Scaled and rotated variants of the image are keyed by their size, which
+ * is what the panel size and orientation come down to with the fit,
+ * stretch and rotate options. A few are kept so that a panel going back and
+ * forth between sizes does not scale the image again. */
+#define PANEL_BACKGROUND_MAX_VARIANTS 4
+
+typedef struct {
+  int width;
+  int height;
+  gboolean rotated;
+  GdkPixbuf *pixbuf;
+} PanelBackgroundVariant;
+
 static gboolean panel_background_composite(PanelBackground *background);
 static void load_background_file(PanelBackground *background);
 
@@ -178,6 +191,8 @@ static void free_composited_resources(PanelBackground *background) {
   background->composited_pattern = NULL;
 }
 
+static guint last_composited_generation = 0;
+
 static cairo_pattern_t *composite_image_onto_desktop(
     PanelBackground *background) {
   int width, height;
@@ -231,7 +246,13 @@ static gboolean panel_background_composite(PanelBackground *background) {
       break;
   }
 
+  /* shared by all the panels, since their pixmaps share the XID space */
+  if (background->composited_pattern)
+    background->composited_generation = ++last_composited_generation;
+
   background->composited = TRUE;
+  background->composited_width = background->region.width;
+  background->composited_height = background->region.height;
 
   panel_background_prepare(background);
 
@@ -250,14 +271,73 @@ static void free_transformed_resources(PanelBackground *background) {
   background->transformed_image = NULL;
 }
 
+static void panel_background_variant_free(PanelBackgroundVariant *variant) {
+  g_object_unref(variant->pixbuf);
+  g_free(variant);
+}
+
+static void free_transformed_cache(PanelBackground *background) {
+  g_list_free_full(background->transformed_cache,
+                   (GDestroyNotify)panel_background_variant_free);
+  background->transformed_cache = NULL;
+}
+
+static GdkPixbuf *lookup_transformed_cache(PanelBackground *background,
+                                           int width, int height,
+                                           gboolean rotated) {
+  GList *l;
+
+  for (l = background->transformed_cache; l; l = l->next) {
+    PanelBackgroundVariant *variant = l->data;
+
+    if (variant->width != width || variant->height != height ||
+        variant->rotated != rotated)
+      continue;
+
+    background->transformed_cache =
+        g_list_remove_link(background->transformed_cache, l);
+    background->transformed_cache =
+        g_list_concat(l, background->transformed_cache);
+
+    return g_object_ref(variant->pixbuf);
+  }
+
+  return NULL;
+}
+
+static void add_to_transformed_cache(PanelBackground *background, int width,
+                                     int height, gboolean rotated,
+                                     GdkPixbuf *pixbuf) {
+  PanelBackgroundVariant *variant;
+  GList *last;
+
+  variant = g_new0(PanelBackgroundVariant, 1);
+  variant->width = width;
+  variant->height = height;
+  variant->rotated = rotated;
+  variant->pixbuf = g_object_ref(pixbuf);
+
+  background->transformed_cache =
+      g_list_prepend(background->transformed_cache, variant);
+
+  last = g_list_nth(background->transformed_cache,
+                    PANEL_BACKGROUND_MAX_VARIANTS);
+  if (last) {
+    last->prev->next = NULL;
+    last->prev = NULL;
+    g_list_free_full(last, (GDestroyNotify)panel_background_variant_free);
+  }
+}
+
 static GdkPixbuf *get_scaled_and_rotated_pixbuf(PanelBackground *background) {
   GdkPixbuf *scaled;
   GdkPixbuf *retval;
   int orig_width, orig_height;
   int panel_width, panel_height;
   int width, height;
+  gboolean rotated;
 
-  load_background_file(background);
+  if (!background->loaded) load_background_file(background);
   if (!background->loaded_image) return NULL;
 
   orig_width = gdk_pixbuf_get_width(background->loaded_image);
@@ -304,6 +384,12 @@ static GdkPixbuf *get_scaled_and_rotated_pixbuf(PanelBackground *background) {
     height = tmp;
   }
 
+  rotated = background->rotate_image &&
+            background->orientation == GTK_ORIENTATION_VERTICAL;
+
+  retval = lookup_transformed_cache(background, width, height, rotated);
+  if (retval) return retval;
+
   if (width == orig_width && height == orig_height) {
     scaled = background->loaded_image;
     g_object_ref(scaled);
@@ -312,8 +398,9 @@ static GdkPixbuf *get_scaled_and_rotated_pixbuf(PanelBackground *background) {
                                      GDK_INTERP_BILINEAR);
   }
 
-  if (background->rotate_image &&
-      background->orientation == GTK_ORIENTATION_VERTICAL) {
+  if (scaled == NULL) return NULL;
+
+  if (rotated) {
     if (!background->has_alpha) {
       guchar *dest;
       guchar *src;
@@ -361,17 +448,33 @@ static GdkPixbuf *get_scaled_and_rotated_pixbuf(PanelBackground *background) {
   } else
     retval = scaled;
 
+  add_to_transformed_cache(background, width, height, rotated, retval);
+
   return retval;
 }
 
+/* Returns FALSE if the current background could be kept */
 static gboolean panel_background_transform(PanelBackground *background) {
-  if (background->region.width == -1) return FALSE;
+  GdkPixbuf *transformed_image = NULL;
 
-  free_transformed_resources(background);
+  if (background->region.width == -1) return FALSE;
 
   if (background->type == PANEL_BACK_IMAGE)
-    background->transformed_image = get_scaled_and_rotated_pixbuf(background);
+    transformed_image = get_scaled_and_rotated_pixbuf(background);
+
+  /* The image is tiled from the origin of the panel: a composited pattern
+   * at least as large as the panel, from the same image, is still right */
+  if (background->transformed && background->composited &&
+      transformed_image == background->transformed_image &&
+      background->composited_width >= background->region.width &&
+      background->composited_height >= background->region.height) {
+    if (transformed_image) g_object_unref(transformed_image);
+    return FALSE;
+  }
 
+  free_transformed_resources(background);
+
+  background->transformed_image = transformed_image;
   background->transformed = TRUE;
 
   panel_background_composite(background);
@@ -394,6 +497,9 @@ static void panel_background_update_has_alpha(PanelBackground *background) {
 static void load_background_file(PanelBackground *background) {
   GError *error = NULL;
 
+  /* decoded once, until the image changes */
+  background->loaded = TRUE;
+
   if (!g_file_test(background->image, G_FILE_TEST_IS_REGULAR)) return;
 
   /* FIXME add a monitor on the file so that we reload the background
@@ -448,6 +554,8 @@ void panel_background_set_color(PanelBackground *background,
 static void panel_background_set_image_no_update(PanelBackground *background,
                                                  const char *image) {
   g_clear_object(&background->loaded_image);
+  background->loaded = FALSE;
+  free_transformed_cache(background);
   g_free(background->image);
 
   if (image && image[0])
@@ -564,8 +672,7 @@ void panel_background_unrealized(PanelBackground *background) {
 void panel_background_change_region(PanelBackground *background,
                                     GtkOrientation orientation, int x, int y,
                                     int width, int height) {
-  gboolean need_to_retransform = FALSE;
-  gboolean need_to_reprepare = FALSE;
+  gboolean size_changed;
 
   if (background->region.x == x && background->region.y == y &&
       background->region.width == width &&
@@ -573,46 +680,29 @@ void panel_background_change_region(PanelBackground *background,
       background->orientation == orientation)
     return;
 
-  /* we only need to retransform anything
-     on size/orientation changes if the
-     background is an image and some
-     conditions are met */
-  if (background->type == PANEL_BACK_IMAGE) {
-    if (background->orientation != orientation && background->rotate_image) {
-      /* if orientation changes and we are rotating */
-      need_to_retransform = TRUE;
-    } else if ((background->region.width != width ||
-                background->region.height != height) &&
-               (background->fit_image || background->stretch_image)) {
-      /* or if the size changes and we are
-         stretching or fitting the image */
-      need_to_retransform = TRUE;
-    }
-  }
-
-  /* if size changed, we at least need
-     to "prepare" the background again */
-  if (background->region.width != width || background->region.height != height)
-    need_to_reprepare = TRUE;
+  size_changed =
+      background->region.width != width || background->region.height != height;
 
   background->region.x = x;
   background->region.y = y;
   background->region.width = width;
   background->region.height = height;
 
+  /* nothing depends on the position of the panel: moving it, as auto-hide
+   * and the slide animation do, costs nothing */
+  if (!size_changed && background->orientation == orientation &&
+      background->transformed)
+    return;
+
   background->orientation = orientation;
 
-  if (need_to_retransform || !background->transformed)
-    /* only retransform the background if we have in
-       fact changed size/orientation */
-    panel_background_transform(background);
-  else if (background->has_alpha || !background->composited)
-    /* only do compositing if we have some alpha
-       value to worry about */
-    panel_background_composite(background);
-  else if (need_to_reprepare)
-    /* at least we must prepare the background
-       if the size changed */
+  /* the transformed images and the composited pattern are reused when
+   * the new size or orientation does not affect them */
+  if (panel_background_transform(background)) return;
+
+  /* at least we must prepare the background if the size changed, the
+   * theme background-image is scaled to the panel */
+  if (size_changed && !background->composited_pattern)
     panel_background_prepare(background);
 }
 
@@ -637,7 +727,11 @@ void panel_background_init(PanelBackground *background,
   background->region.width = -1;
   background->region.height = -1;
   background->transformed_image = NULL;
+  background->transformed_cache = NULL;
   background->composited_pattern = NULL;
+  background->composited_width = 0;
+  background->composited_height = 0;
+  background->composited_generation = 0;
 
   background->window = NULL;
 
@@ -654,12 +748,14 @@ void panel_background_init(PanelBackground *background,
 
   background->has_alpha = FALSE;
 
+  background->loaded = FALSE;
   background->transformed = FALSE;
   background->composited = FALSE;
 }
 
 void panel_background_free(PanelBackground *background) {
   free_transformed_resources(background);
+  free_transformed_cache(background);
 
   g_clear_pointer(&background->image, g_free);
 
@@ -690,9 +786,9 @@ char *panel_background_make_string(PanelBackground *background, int x, int y) {
 
     if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_XLIB) return NULL;
 
-    retval = g_strdup_printf("pixmap:%d,%d,%d",
+    retval = g_strdup_printf("pixmap:%d,%d,%d,%u",
                              (guint32)cairo_xlib_surface_get_drawable(surface),
-                             x, y);
+                             x, y, background->composited_generation);
   } else if (effective_type == PANEL_BACK_COLOR) {
     gchar *rgba = gdk_rgba_to_string(&background->color);
     retval = g_strdup_printf("color:%s", rgba);
@@ -52,7 +52,14 @@ struct _PanelBackground {
   GtkOrientation orientation;
   GdkRectangle region;
   GdkPixbuf *transformed_image;
+  /* scaled and rotated variants of loaded_image, most recent first */
+  GList *transformed_cache;
   cairo_pattern_t *composited_pattern;
+  int composited_width;
+  int composited_height;
+  /* bumped for each new composited_pattern, so that applets can tell a
+   * new pixmap from a recycled XID */
+  guint composited_generation;
 
   GdkWindow *window;
   cairo_pattern_t *default_pattern;
@@ -0,0 +1,350 @@
+/*
+ * panel-completion-model.c: sorted, prefix-filtered completion model
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "panel-completion-model.h"
+
+#include <string.h>
+
+/* A single column list model over a sorted array of strings. Only the rows
+ * starting with the current prefix, ignoring ASCII case as the completion
+ * always did, are exposed; since they are contiguous in the array, this is
+ * a window found by binary search. When the prefix grows, the new window is
+ * searched for inside the previous one and the rows falling out of it are
+ * removed from both ends, so the cost of a keystroke does not depend on how
+ * many items were seen before. */
+
+static void panel_completion_model_tree_model_init(GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(PanelCompletionModel, panel_completion_model,
+                        G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(
+                            GTK_TYPE_TREE_MODEL,
+                            panel_completion_model_tree_model_init))
+
+#define N_ROWS(model) ((model)->last - (model)->first)
+#define ROW_INDEX(iter) (GPOINTER_TO_UINT((iter)->user_data))
+
+static GtkTreeModelFlags panel_completion_model_get_flags(
+    GtkTreeModel *tree_model) {
+  return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint panel_completion_model_get_n_columns(GtkTreeModel *tree_model) {
+  return 1;
+}
+
+static GType panel_completion_model_get_column_type(GtkTreeModel *tree_model,
+                                                    gint index) {
+  g_return_val_if_fail(index == 0, G_TYPE_INVALID);
+
+  return G_TYPE_STRING;
+}
+
+static gboolean panel_completion_model_set_iter(PanelCompletionModel *model,
+                                                GtkTreeIter *iter, guint row) {
+  if (row >= N_ROWS(model)) {
+    iter->stamp = 0;
+    return FALSE;
+  }
+
+  iter->stamp = model->stamp;
+  iter->user_data = GUINT_TO_POINTER(row);
+
+  return TRUE;
+}
+
+static gboolean panel_completion_model_get_iter(GtkTreeModel *tree_model,
+                                                GtkTreeIter *iter,
+                                                GtkTreePath *path) {
+  PanelCompletionModel *model = PANEL_COMPLETION_MODEL(tree_model);
+
+  if (gtk_tree_path_get_depth(path) != 1) return FALSE;
+
+  return panel_completion_model_set_iter(model, iter,
+                                         gtk_tree_path_get_indices(path)[0]);
+}
+
+static GtkTreePath *panel_completion_model_get_path(GtkTreeModel *tree_model,
+                                                    GtkTreeIter *iter) {
+  PanelCompletionModel *model = PANEL_COMPLETION_MODEL(tree_model);
+
+  g_return_val_if_fail(iter->stamp == model->stamp, NULL);
+
+  return gtk_tree_path_new_from_indices(ROW_INDEX(iter), -1);
+}
+
+static void panel_completion_model_get_value(GtkTreeModel *tree_model,
+                                             GtkTreeIter *iter, gint column,
+                                             GValue *value) {
+  PanelCompletionModel *model = PANEL_COMPLETION_MODEL(tree_model);
+
+  g_return_if_fail(column == 0);
+  g_return_if_fail(iter->stamp == model->stamp);
+
+  g_value_init(value, G_TYPE_STRING);
+  g_value_set_string(
+      value, g_ptr_array_index(model->items, model->first + ROW_INDEX(iter)));
+}
+
+static gboolean panel_completion_model_iter_next(GtkTreeModel *tree_model,
+                                                 GtkTreeIter *iter) {
+  PanelCompletionModel *model = PANEL_COMPLETION_MODEL(tree_model);
+
+  g_return_val_if_fail(iter->stamp == model->stamp, FALSE);
+
+  return panel_completion_model_set_iter(model, iter, ROW_INDEX(iter) + 1);
+}
+
+static gboolean panel_completion_model_iter_previous(GtkTreeModel *tree_model,
+                                                     GtkTreeIter *iter) {
+  PanelCompletionModel *model = PANEL_COMPLETION_MODEL(tree_model);
+
+  g_return_val_if_fail(iter->stamp == model->stamp, FALSE);
+
+  if (ROW_INDEX(iter) == 0) {
+    iter->stamp = 0;
+    return FALSE;
+  }
+
+  return panel_completion_model_set_iter(model, iter, ROW_INDEX(iter) - 1);
+}
+
+static gboolean panel_completion_model_iter_children(GtkTreeModel *tree_model,
+                                                     GtkTreeIter *iter,
+                                                     GtkTreeIter *parent) {
+  if (parent) return FALSE;
+
+  return panel_completion_model_set_iter(PANEL_COMPLETION_MODEL(tree_model),
+                                         iter, 0);
+}
+
+static gboolean panel_completion_model_iter_has_child(GtkTreeModel *tree_model,
+                                                      GtkTreeIter *iter) {
+  return FALSE;
+}
+
+static gint panel_completion_model_iter_n_children(GtkTreeModel *tree_model,
+                                                   GtkTreeIter *iter) {
+  if (iter) return 0;
+
+  return N_ROWS(PANEL_COMPLETION_MODEL(tree_model));
+}
+
+static gboolean panel_completion_model_iter_nth_child(GtkTreeModel *tree_model,
+                                                      GtkTreeIter *iter,
+                                                      GtkTreeIter *parent,
+                                                      gint n) {
+  if (parent || n < 0) return FALSE;
+
+  return panel_completion_model_set_iter(PANEL_COMPLETION_MODEL(tree_model),
+                                         iter, n);
+}
+
+static gboolean panel_completion_model_iter_parent(GtkTreeModel *tree_model,
+                                                   GtkTreeIter *iter,
+                                                   GtkTreeIter *child) {
+  return FALSE;
+}
+
+static void panel_completion_model_tree_model_init(GtkTreeModelIface *iface) {
+  iface->get_flags = panel_completion_model_get_flags;
+  iface->get_n_columns = panel_completion_model_get_n_columns;
+  iface->get_column_type = panel_completion_model_get_column_type;
+  iface->get_iter = panel_completion_model_get_iter;
+  iface->get_path = panel_completion_model_get_path;
+  iface->get_value = panel_completion_model_get_value;
+  iface->iter_next = panel_completion_model_iter_next;
+  iface->iter_previous = panel_completion_model_iter_previous;
+  iface->iter_children = panel_completion_model_iter_children;
+  iface->iter_has_child = panel_completion_model_iter_has_child;
+  iface->iter_n_children = panel_completion_model_iter_n_children;
+  iface->iter_nth_child = panel_completion_model_iter_nth_child;
+  iface->iter_parent = panel_completion_model_iter_parent;
+}
+
+/* Returns the index of the first item in [lo, hi) for which
+ * g_ascii_strncasecmp (item, prefix, strlen (prefix)) is greater than (or
+ * equal to, if inclusive) zero. */
+static guint panel_completion_model_bound(PanelCompletionModel *model,
+                                          guint lo, guint hi,
+                                          const char *prefix,
+                                          gboolean inclusive) {
+  size_t len = strlen(prefix);
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    int cmp = g_ascii_strncasecmp(g_ptr_array_index(model->items, mid),
+                                  prefix, len);
+
+    if (cmp < 0 || (!inclusive && cmp == 0))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static void panel_completion_model_shrink(PanelCompletionModel *model,
+                                          guint first, guint last) {
+  GtkTreePath *path;
+
+  while (model->last > last) {
+    model->last--;
+    model->stamp++;
+
+    path = gtk_tree_path_new_from_indices(N_ROWS(model), -1);
+    gtk_tree_model_row_deleted(GTK_TREE_MODEL(model), path);
+    gtk_tree_path_free(path);
+  }
+
+  while (model->first < first) {
+    model->first++;
+    model->stamp++;
+
+    path = gtk_tree_path_new_first();
+    gtk_tree_model_row_deleted(GTK_TREE_MODEL(model), path);
+    gtk_tree_path_free(path);
+  }
+}
+
+static void panel_completion_model_fill(PanelCompletionModel *model,
+                                        guint first, guint last) {
+  GtkTreePath *path;
+  GtkTreeIter iter;
+
+  g_assert(N_ROWS(model) == 0);
+
+  model->first = model->last = first;
+
+  while (model->last < last) {
+    model->last++;
+    model->stamp++;
+
+    panel_completion_model_set_iter(model, &iter, N_ROWS(model) - 1);
+    path = gtk_tree_path_new_from_indices(N_ROWS(model) - 1, -1);
+    gtk_tree_model_row_inserted(GTK_TREE_MODEL(model), path, &iter);
+    gtk_tree_path_free(path);
+  }
+}
+
+static void panel_completion_model_refilter(PanelCompletionModel *model,
+                                            gboolean narrowing) {
+  guint lo, hi;
+  guint first, last;
+
+  lo = narrowing ? model->first : 0;
+  hi = narrowing ? model->last : model->items->len;
+
+  first = panel_completion_model_bound(model, lo, hi, model->prefix, TRUE);
+  last = panel_completion_model_bound(model, first, hi, model->prefix, FALSE);
+
+  if (narrowing) {
+    panel_completion_model_shrink(model, first, last);
+  } else {
+    panel_completion_model_shrink(model, model->first, model->first);
+    panel_completion_model_fill(model, first, last);
+  }
+}
+
+static int panel_completion_model_compare(gconstpointer a, gconstpointer b) {
+  return g_ascii_strcasecmp(*(const char **)a, *(const char **)b);
+}
+
+void panel_completion_model_add_items(PanelCompletionModel *model,
+                                      GList *items) {
+  gboolean changed = FALSE;
+  GList *l;
+
+  g_return_if_fail(PANEL_IS_COMPLETION_MODEL(model));
+
+  for (l = items; l; l = l->next) {
+    char *item;
+
+    if (g_hash_table_contains(model->items_set, l->data)) continue;
+
+    if (!changed) {
+      /* indexes are about to move: drop the current rows first */
+      panel_completion_model_shrink(model, model->first, model->first);
+      changed = TRUE;
+    }
+
+    item = g_strdup(l->data);
+    g_hash_table_add(model->items_set, item);
+    g_ptr_array_add(model->items, item);
+  }
+
+  if (!changed) return;
+
+  g_ptr_array_sort(model->items, panel_completion_model_compare);
+  panel_completion_model_refilter(model, FALSE);
+}
+
+void panel_completion_model_set_prefix(PanelCompletionModel *model,
+                                       const char *prefix) {
+  gboolean narrowing;
+
+  g_return_if_fail(PANEL_IS_COMPLETION_MODEL(model));
+  g_return_if_fail(prefix != NULL);
+
+  if (strcmp(model->prefix, prefix) == 0) return;
+
+  narrowing =
+      g_ascii_strncasecmp(prefix, model->prefix, strlen(model->prefix)) == 0;
+
+  g_free(model->prefix);
+  model->prefix = g_strdup(prefix);
+
+  panel_completion_model_refilter(model, narrowing);
+}
+
+static void panel_completion_model_finalize(GObject *object) {
+  PanelCompletionModel *model = PANEL_COMPLETION_MODEL(object);
+
+  g_ptr_array_unref(model->items);
+  g_hash_table_destroy(model->items_set);
+  g_free(model->prefix);
+
+  G_OBJECT_CLASS(panel_completion_model_parent_class)->finalize(object);
+}
+
+static void panel_completion_model_class_init(
+    PanelCompletionModelClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  gobject_class->finalize = panel_completion_model_finalize;
+}
+
+static void panel_completion_model_init(PanelCompletionModel *model) {
+  model->items = g_ptr_array_new();
+  model->items_set =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  model->prefix = g_strdup("");
+  model->stamp = g_random_int();
+}
+
+PanelCompletionModel *panel_completion_model_new(void) {
+  return g_object_new(PANEL_TYPE_COMPLETION_MODEL, NULL);
+}
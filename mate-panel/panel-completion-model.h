@@ -0,0 +1,77 @@
+/*
+ * panel-completion-model.h: sorted, prefix-filtered completion model
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_COMPLETION_MODEL_H__
+#define __PANEL_COMPLETION_MODEL_H__
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define PANEL_TYPE_COMPLETION_MODEL (panel_completion_model_get_type())
+#define PANEL_COMPLETION_MODEL(o)                                 \
+  (G_TYPE_CHECK_INSTANCE_CAST((o), PANEL_TYPE_COMPLETION_MODEL, \
+                              PanelCompletionModel))
+#define PANEL_COMPLETION_MODEL_CLASS(k)                        \
+  (G_TYPE_CHECK_CLASS_CAST((k), PANEL_TYPE_COMPLETION_MODEL, \
+                           PanelCompletionModelClass))
+#define PANEL_IS_COMPLETION_MODEL(o) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((o), PANEL_TYPE_COMPLETION_MODEL))
+#define PANEL_IS_COMPLETION_MODEL_CLASS(k) \
+  (G_TYPE_CHECK_CLASS_TYPE((k), PANEL_TYPE_COMPLETION_MODEL))
+#define PANEL_COMPLETION_MODEL_GET_CLASS(o)                     \
+  (G_TYPE_INSTANCE_GET_CLASS((o), PANEL_TYPE_COMPLETION_MODEL, \
+                             PanelCompletionModelClass))
+
+typedef struct _PanelCompletionModel PanelCompletionModel;
+typedef struct _PanelCompletionModelClass PanelCompletionModelClass;
+
+struct _PanelCompletionModel {
+  GObject parent_instance;
+
+  /* all the known items, sorted with g_ascii_strcasecmp () */
+  GPtrArray *items;
+  GHashTable *items_set;
+
+  /* the rows exposed are items [first, last) */
+  char *prefix;
+  guint first;
+  guint last;
+
+  int stamp;
+};
+
+struct _PanelCompletionModelClass {
+  GObjectClass parent_class;
+};
+
+GType panel_completion_model_get_type(void) G_GNUC_CONST;
+PanelCompletionModel *panel_completion_model_new(void);
+
+void panel_completion_model_add_items(PanelCompletionModel *model,
+                                      GList *items);
+void panel_completion_model_set_prefix(PanelCompletionModel *model,
+                                       const char *prefix);
+
+G_END_DECLS
+
+#endif /* __PANEL_COMPLETION_MODEL_H__ */
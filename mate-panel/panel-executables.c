@@ -0,0 +1,509 @@
+/*
+ * panel-executables.c: resident index of the executables found in $PATH
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "panel-executables.h"
+
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The index is built the first time the run dialog needs it and then kept
+ * up to date with one directory monitor per $PATH entry, so completing a
+ * command never has to touch the file system. A copy is written to the
+ * user cache directory so the next panel session only rescans the
+ * directories that changed in the meantime right away. The other ones are
+ * taken from the cache, then rescanned one at a time in idle time: making
+ * a file executable does not change the modification time of its
+ * directory. */
+
+#define PANEL_EXECUTABLES_CACHE_NAME "executables"
+#define PANEL_EXECUTABLES_CACHE_HEADER "# mate-panel executables cache v1"
+#define PANEL_EXECUTABLES_SAVE_TIMEOUT 5
+
+typedef struct {
+  char *path;
+  GHashTable *names;
+  GFileMonitor *monitor;
+  /* the names come from the cache and were not checked yet */
+  gboolean from_cache;
+} PanelExecutablesDir;
+
+typedef struct {
+  char *search_path;
+  GPtrArray *dirs;
+  /* basename -> number of $PATH directories providing it */
+  GHashTable *names;
+  /* the keys of names, sorted; rebuilt lazily after a change */
+  GPtrArray *sorted;
+  guint save_id;
+  guint verify_id;
+} PanelExecutables;
+
+static PanelExecutables *executables = NULL;
+
+static char *panel_executables_get_cache_file(void) {
+  return g_build_filename(g_get_user_cache_dir(), "mate-panel",
+                          PANEL_EXECUTABLES_CACHE_NAME, NULL);
+}
+
+static gboolean panel_executables_is_executable(const char *filename) {
+  GStatBuf buf;
+
+  if (g_stat(filename, &buf) != 0) return FALSE;
+
+  return S_ISREG(buf.st_mode) && g_access(filename, X_OK) == 0;
+}
+
+static gboolean panel_executables_add(PanelExecutablesDir *dir,
+                                      const char *name) {
+  guint count;
+
+  if (g_hash_table_contains(dir->names, name)) return FALSE;
+
+  g_hash_table_add(dir->names, g_strdup(name));
+
+  count = GPOINTER_TO_UINT(g_hash_table_lookup(executables->names, name));
+  g_hash_table_replace(executables->names, g_strdup(name),
+                       GUINT_TO_POINTER(count + 1));
+
+  if (count == 0) g_clear_pointer(&executables->sorted, g_ptr_array_unref);
+
+  return TRUE;
+}
+
+static gboolean panel_executables_remove(PanelExecutablesDir *dir,
+                                         const char *name) {
+  guint count;
+
+  if (!g_hash_table_remove(dir->names, name)) return FALSE;
+
+  count = GPOINTER_TO_UINT(g_hash_table_lookup(executables->names, name));
+  if (count <= 1) {
+    g_clear_pointer(&executables->sorted, g_ptr_array_unref);
+    g_hash_table_remove(executables->names, name);
+  } else
+    g_hash_table_replace(executables->names, g_strdup(name),
+                         GUINT_TO_POINTER(count - 1));
+
+  return TRUE;
+}
+
+/* Returns whether the names known for the directory changed */
+static gboolean panel_executables_dir_scan(PanelExecutablesDir *dir) {
+  GHashTable *found;
+  GHashTableIter iter;
+  GPtrArray *gone;
+  GDir *gdir;
+  gpointer key;
+  const char *name;
+  gboolean changed = FALSE;
+  guint i;
+
+  found = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  gdir = g_dir_open(dir->path, 0, NULL);
+  if (gdir) {
+    while ((name = g_dir_read_name(gdir))) {
+      char *filename;
+
+      /* such names would break the cache file */
+      if (strchr(name, '\n')) continue;
+
+      filename = g_build_filename(dir->path, name, NULL);
+      if (panel_executables_is_executable(filename))
+        g_hash_table_add(found, g_strdup(name));
+      g_free(filename);
+    }
+
+    g_dir_close(gdir);
+  }
+
+  /* the names read from the cache that are not there anymore */
+  gone = g_ptr_array_new_with_free_func(g_free);
+  g_hash_table_iter_init(&iter, dir->names);
+  while (g_hash_table_iter_next(&iter, &key, NULL))
+    if (!g_hash_table_contains(found, key))
+      g_ptr_array_add(gone, g_strdup(key));
+
+  for (i = 0; i < gone->len; i++)
+    changed |= panel_executables_remove(dir, g_ptr_array_index(gone, i));
+  g_ptr_array_unref(gone);
+
+  g_hash_table_iter_init(&iter, found);
+  while (g_hash_table_iter_next(&iter, &key, NULL))
+    changed |= panel_executables_add(dir, key);
+  g_hash_table_destroy(found);
+
+  dir->from_cache = FALSE;
+
+  return changed;
+}
+
+static void panel_executables_save(void) {
+  GString *str;
+  char *filename;
+  char *dirname;
+  GError *error = NULL;
+  guint i;
+
+  str = g_string_new(PANEL_EXECUTABLES_CACHE_HEADER "\n");
+  g_string_append_printf(str, "PATH=%s\n", executables->search_path);
+
+  for (i = 0; i < executables->dirs->len; i++) {
+    PanelExecutablesDir *dir = g_ptr_array_index(executables->dirs, i);
+    GHashTableIter iter;
+    gpointer name;
+
+    g_string_append_printf(str, "D %s\n", dir->path);
+
+    g_hash_table_iter_init(&iter, dir->names);
+    while (g_hash_table_iter_next(&iter, &name, NULL))
+      g_string_append_printf(str, "F %s\n", (const char *)name);
+  }
+
+  filename = panel_executables_get_cache_file();
+  dirname = g_path_get_dirname(filename);
+
+  if (g_mkdir_with_parents(dirname, 0700) != 0 ||
+      !g_file_set_contents(filename, str->str, str->len, &error)) {
+    g_warning("Cannot save executables cache '%s': %s", filename,
+              error ? error->message : g_strerror(errno));
+    g_clear_error(&error);
+  }
+
+  g_free(dirname);
+  g_free(filename);
+  g_string_free(str, TRUE);
+}
+
+static gboolean panel_executables_save_timeout(gpointer user_data) {
+  executables->save_id = 0;
+  panel_executables_save();
+
+  return G_SOURCE_REMOVE;
+}
+
+static void panel_executables_queue_save(void) {
+  if (executables->save_id) return;
+
+  executables->save_id = g_timeout_add_seconds(
+      PANEL_EXECUTABLES_SAVE_TIMEOUT, panel_executables_save_timeout, NULL);
+}
+
+/* Rescans one of the directories taken from the cache per call */
+static gboolean panel_executables_verify_idle(gpointer user_data) {
+  guint i;
+
+  for (i = 0; i < executables->dirs->len; i++) {
+    PanelExecutablesDir *dir = g_ptr_array_index(executables->dirs, i);
+
+    if (!dir->from_cache) continue;
+
+    if (panel_executables_dir_scan(dir)) panel_executables_queue_save();
+
+    return G_SOURCE_CONTINUE;
+  }
+
+  executables->verify_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void panel_executables_dir_changed(GFileMonitor *monitor, GFile *file,
+                                          GFile *other_file,
+                                          GFileMonitorEvent event_type,
+                                          PanelExecutablesDir *dir) {
+  char *name;
+  char *filename;
+
+  name = g_file_get_basename(file);
+  if (!name || strchr(name, '\n')) {
+    g_free(name);
+    return;
+  }
+
+  switch (event_type) {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+      filename = g_file_get_path(file);
+      if (filename && panel_executables_is_executable(filename))
+        panel_executables_add(dir, name);
+      else
+        panel_executables_remove(dir, name);
+      g_free(filename);
+      panel_executables_queue_save();
+      break;
+    case G_FILE_MONITOR_EVENT_DELETED:
+      panel_executables_remove(dir, name);
+      panel_executables_queue_save();
+      break;
+    default:
+      /* Ignore any other change */
+      break;
+  }
+
+  g_free(name);
+}
+
+static void panel_executables_dir_free(PanelExecutablesDir *dir) {
+  if (dir->monitor) {
+    g_signal_handlers_disconnect_by_func(
+        dir->monitor, G_CALLBACK(panel_executables_dir_changed), dir);
+    g_file_monitor_cancel(dir->monitor);
+    g_object_unref(dir->monitor);
+  }
+
+  g_hash_table_destroy(dir->names);
+  g_free(dir->path);
+  g_free(dir);
+}
+
+static PanelExecutablesDir *panel_executables_dir_new(const char *path) {
+  PanelExecutablesDir *dir;
+  GFile *file;
+
+  dir = g_new0(PanelExecutablesDir, 1);
+  dir->path = g_strdup(path);
+  dir->names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  file = g_file_new_for_path(path);
+  dir->monitor =
+      g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (dir->monitor)
+    g_signal_connect(dir->monitor, "changed",
+                     G_CALLBACK(panel_executables_dir_changed), dir);
+  g_object_unref(file);
+
+  return dir;
+}
+
+/* Returns a table mapping each directory found in the cache to the list of
+ * names it contained, or NULL if the cache is missing or was written for
+ * another $PATH. Directories modified after the cache was written are
+ * left out so they get rescanned. */
+static GHashTable *panel_executables_load_cache(void) {
+  GHashTable *cached;
+  GStatBuf buf;
+  char *filename;
+  char *contents;
+  char **lines;
+  GPtrArray *current;
+  time_t cache_mtime;
+  int i;
+
+  filename = panel_executables_get_cache_file();
+
+  if (g_stat(filename, &buf) != 0 ||
+      !g_file_get_contents(filename, &contents, NULL, NULL)) {
+    g_free(filename);
+    return NULL;
+  }
+  g_free(filename);
+
+  cache_mtime = buf.st_mtime;
+  lines = g_strsplit(contents, "\n", -1);
+  g_free(contents);
+
+  if (!lines[0] || strcmp(lines[0], PANEL_EXECUTABLES_CACHE_HEADER) != 0 ||
+      !lines[1] || !g_str_has_prefix(lines[1], "PATH=") ||
+      strcmp(lines[1] + strlen("PATH="), executables->search_path) != 0) {
+    g_strfreev(lines);
+    return NULL;
+  }
+
+  cached = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                 (GDestroyNotify)g_ptr_array_unref);
+  current = NULL;
+
+  for (i = 2; lines[i]; i++) {
+    if (g_str_has_prefix(lines[i], "D ")) {
+      const char *path = lines[i] + 2;
+
+      current = NULL;
+      if (g_stat(path, &buf) != 0 || buf.st_mtime >= cache_mtime) continue;
+
+      current = g_ptr_array_new_with_free_func(g_free);
+      g_hash_table_replace(cached, g_strdup(path), current);
+    } else if (current && g_str_has_prefix(lines[i], "F ")) {
+      g_ptr_array_add(current, g_strdup(lines[i] + 2));
+    }
+  }
+
+  g_strfreev(lines);
+
+  return cached;
+}
+
+static void panel_executables_free(void) {
+  if (!executables) return;
+
+  if (executables->verify_id) g_source_remove(executables->verify_id);
+
+  if (executables->save_id) {
+    g_source_remove(executables->save_id);
+    panel_executables_save();
+  }
+
+  g_clear_pointer(&executables->sorted, g_ptr_array_unref);
+  g_ptr_array_free(executables->dirs, TRUE);
+  g_hash_table_destroy(executables->names);
+  g_free(executables->search_path);
+  g_free(executables);
+  executables = NULL;
+}
+
+void panel_executables_ensure(void) {
+  GHashTable *cached;
+  const char *path;
+  char **pathv;
+  gboolean scanned;
+  int i;
+
+  path = g_getenv("PATH");
+  if (!path) path = "";
+
+  if (executables && strcmp(executables->search_path, path) == 0) return;
+
+  panel_executables_free();
+
+  executables = g_new0(PanelExecutables, 1);
+  executables->search_path = g_strdup(path);
+  executables->dirs = g_ptr_array_new_with_free_func(
+      (GDestroyNotify)panel_executables_dir_free);
+  executables->names =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  cached = panel_executables_load_cache();
+  scanned = (cached == NULL);
+
+  pathv = g_strsplit(path, ":", 0);
+
+  for (i = 0; pathv[i]; i++) {
+    PanelExecutablesDir *dir;
+    GPtrArray *names;
+    guint j;
+
+    if (!pathv[i][0]) continue;
+
+    /* the same directory may appear several times in $PATH */
+    for (j = 0; j < executables->dirs->len; j++) {
+      dir = g_ptr_array_index(executables->dirs, j);
+      if (strcmp(dir->path, pathv[i]) == 0) break;
+    }
+    if (j < executables->dirs->len) continue;
+
+    dir = panel_executables_dir_new(pathv[i]);
+    g_ptr_array_add(executables->dirs, dir);
+
+    names = cached ? g_hash_table_lookup(cached, pathv[i]) : NULL;
+    if (names) {
+      for (j = 0; j < names->len; j++)
+        panel_executables_add(dir, g_ptr_array_index(names, j));
+      dir->from_cache = TRUE;
+    } else {
+      panel_executables_dir_scan(dir);
+      scanned = TRUE;
+    }
+  }
+
+  g_strfreev(pathv);
+
+  if (cached) {
+    g_hash_table_destroy(cached);
+    executables->verify_id = g_idle_add_full(
+        G_PRIORITY_LOW, panel_executables_verify_idle, NULL, NULL);
+  }
+
+  if (scanned) panel_executables_queue_save();
+}
+
+static int panel_executables_compare(gconstpointer a, gconstpointer b) {
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static GPtrArray *panel_executables_get_sorted(void) {
+  GHashTableIter iter;
+  gpointer name;
+
+  if (executables->sorted) return executables->sorted;
+
+  executables->sorted =
+      g_ptr_array_sized_new(g_hash_table_size(executables->names));
+
+  g_hash_table_iter_init(&iter, executables->names);
+  while (g_hash_table_iter_next(&iter, &name, NULL))
+    g_ptr_array_add(executables->sorted, name);
+
+  g_ptr_array_sort(executables->sorted, panel_executables_compare);
+
+  return executables->sorted;
+}
+
+/* Returns the index of the first name in the sorted array for which
+ * strncmp (name, prefix, len) is greater than (or equal to, if inclusive)
+ * zero. All the names starting with prefix lie in
+ * [bound (prefix, TRUE), bound (prefix, FALSE)). */
+static guint panel_executables_bound(GPtrArray *sorted, const char *prefix,
+                                     gboolean inclusive) {
+  size_t len = strlen(prefix);
+  guint lo = 0;
+  guint hi = sorted->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    int cmp = strncmp(g_ptr_array_index(sorted, mid), prefix, len);
+
+    if (cmp < 0 || (!inclusive && cmp == 0))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+GList *panel_executables_get_with_prefix(const char *prefix) {
+  GPtrArray *sorted;
+  GList *list;
+  guint first;
+  guint i;
+
+  g_return_val_if_fail(prefix != NULL, NULL);
+
+  panel_executables_ensure();
+
+  sorted = panel_executables_get_sorted();
+  first = panel_executables_bound(sorted, prefix, TRUE);
+
+  list = NULL;
+  for (i = panel_executables_bound(sorted, prefix, FALSE); i > first; i--)
+    list = g_list_prepend(list, g_strdup(g_ptr_array_index(sorted, i - 1)));
+
+  return list;
+}
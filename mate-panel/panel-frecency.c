@@ -0,0 +1,256 @@
+/*
+ * panel-frecency.c: launch frequency and recency counts
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "panel-frecency.h"
+
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+/* The counts are kept in a serialized a{s(ux)} GVariant mapping a key (a
+ * desktop file path or a command name) to its launch count and the time
+ * of its last launch. Only the most recently used entries are kept.
+ *
+ * Recording a launch only updates the table: the file is written once
+ * from an idle, asynchronously, whatever the number of keys recorded for
+ * the launch. */
+
+#define PANEL_FRECENCY_FILE "run-frecency"
+#define PANEL_FRECENCY_TYPE "a{s(ux)}"
+#define PANEL_FRECENCY_MAX_ENTRIES 512
+
+typedef struct {
+  guint32 count;
+  gint64 last_used;
+} PanelFrecencyEntry;
+
+static GHashTable *frecency_entries = NULL;
+
+static guint frecency_save_idle_id = 0;
+/* a write is in progress, and whether the table changed since it started */
+static gboolean frecency_saving = FALSE;
+static gboolean frecency_dirty = FALSE;
+
+static void panel_frecency_queue_save(void);
+
+static char *panel_frecency_get_file(void) {
+  return g_build_filename(g_get_user_data_dir(), "mate-panel",
+                          PANEL_FRECENCY_FILE, NULL);
+}
+
+static void panel_frecency_load(void) {
+  GVariant *variant;
+  GVariantIter iter;
+  const char *key;
+  guint32 count;
+  gint64 last_used;
+  char *filename;
+  char *contents;
+  gsize length;
+
+  if (frecency_entries) return;
+
+  frecency_entries =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+  filename = panel_frecency_get_file();
+  if (!g_file_get_contents(filename, &contents, &length, NULL)) {
+    g_free(filename);
+    return;
+  }
+  g_free(filename);
+
+  variant = g_variant_new_from_data(G_VARIANT_TYPE(PANEL_FRECENCY_TYPE),
+                                    contents, length, FALSE, g_free, contents);
+  g_variant_ref_sink(variant);
+
+  g_variant_iter_init(&iter, variant);
+  while (g_variant_iter_next(&iter, "{&s(ux)}", &key, &count, &last_used)) {
+    PanelFrecencyEntry *entry;
+
+    entry = g_new(PanelFrecencyEntry, 1);
+    entry->count = count;
+    entry->last_used = last_used;
+    g_hash_table_replace(frecency_entries, g_strdup(key), entry);
+  }
+
+  g_variant_unref(variant);
+}
+
+static int panel_frecency_compare_last_used(gconstpointer a, gconstpointer b) {
+  const PanelFrecencyEntry *entry_a;
+  const PanelFrecencyEntry *entry_b;
+
+  entry_a = g_hash_table_lookup(frecency_entries, *(const char **)a);
+  entry_b = g_hash_table_lookup(frecency_entries, *(const char **)b);
+
+  if (entry_a->last_used == entry_b->last_used) return 0;
+
+  return entry_a->last_used > entry_b->last_used ? -1 : 1;
+}
+
+static void panel_frecency_save_done(GObject *source, GAsyncResult *result,
+                                     gpointer user_data) {
+  GError *error = NULL;
+
+  if (!g_file_replace_contents_finish(G_FILE(source), result, NULL, &error)) {
+    char *filename = g_file_get_path(G_FILE(source));
+
+    g_warning("Cannot save launch counts to '%s': %s", filename,
+              error->message);
+    g_free(filename);
+    g_error_free(error);
+  }
+
+  frecency_saving = FALSE;
+
+  if (frecency_dirty) {
+    frecency_dirty = FALSE;
+    panel_frecency_queue_save();
+  }
+}
+
+static gboolean panel_frecency_save(gpointer user_data) {
+  GVariantBuilder builder;
+  GVariant *variant;
+  GBytes *bytes;
+  GPtrArray *keys;
+  GHashTableIter iter;
+  gpointer key;
+  GFile *file;
+  char *filename;
+  char *dirname;
+  guint i;
+
+  frecency_save_idle_id = 0;
+
+  keys = g_ptr_array_new();
+  g_hash_table_iter_init(&iter, frecency_entries);
+  while (g_hash_table_iter_next(&iter, &key, NULL)) g_ptr_array_add(keys, key);
+
+  g_ptr_array_sort(keys, panel_frecency_compare_last_used);
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE(PANEL_FRECENCY_TYPE));
+  for (i = 0; i < keys->len && i < PANEL_FRECENCY_MAX_ENTRIES; i++) {
+    PanelFrecencyEntry *entry;
+
+    entry = g_hash_table_lookup(frecency_entries, keys->pdata[i]);
+    g_variant_builder_add(&builder, "{s(ux)}", keys->pdata[i], entry->count,
+                          entry->last_used);
+  }
+
+  /* forget about the entries that did not make it to the file */
+  for (; i < keys->len; i++)
+    g_hash_table_remove(frecency_entries, keys->pdata[i]);
+
+  g_ptr_array_free(keys, TRUE);
+
+  variant = g_variant_ref_sink(g_variant_builder_end(&builder));
+
+  filename = panel_frecency_get_file();
+  dirname = g_path_get_dirname(filename);
+
+  if (g_mkdir_with_parents(dirname, 0700) != 0) {
+    g_warning("Cannot save launch counts to '%s': %s", filename,
+              g_strerror(errno));
+  } else {
+    file = g_file_new_for_path(filename);
+    bytes = g_variant_get_data_as_bytes(variant);
+
+    frecency_saving = TRUE;
+    g_file_replace_contents_bytes_async(file, bytes, NULL, FALSE,
+                                        G_FILE_CREATE_PRIVATE, NULL,
+                                        panel_frecency_save_done, NULL);
+
+    g_bytes_unref(bytes);
+    g_object_unref(file);
+  }
+
+  g_free(dirname);
+  g_free(filename);
+  g_variant_unref(variant);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void panel_frecency_queue_save(void) {
+  /* a single write at a time, so that an older table never wins */
+  if (frecency_saving) {
+    frecency_dirty = TRUE;
+    return;
+  }
+
+  if (!frecency_save_idle_id)
+    frecency_save_idle_id = g_idle_add(panel_frecency_save, NULL);
+}
+
+void panel_frecency_record(const char *key) {
+  PanelFrecencyEntry *entry;
+
+  g_return_if_fail(key != NULL);
+
+  panel_frecency_load();
+
+  entry = g_hash_table_lookup(frecency_entries, key);
+  if (!entry) {
+    entry = g_new0(PanelFrecencyEntry, 1);
+    g_hash_table_replace(frecency_entries, g_strdup(key), entry);
+  }
+
+  if (entry->count < G_MAXUINT32) entry->count++;
+  entry->last_used = g_get_real_time() / G_USEC_PER_SEC;
+
+  panel_frecency_queue_save();
+}
+
+/* Returns the launch count weighted by how long ago the last launch
+ * happened, or 0 if key was never launched. */
+int panel_frecency_get_score(const char *key) {
+  PanelFrecencyEntry *entry;
+  gint64 age;
+  int weight;
+
+  if (!key) return 0;
+
+  panel_frecency_load();
+
+  entry = g_hash_table_lookup(frecency_entries, key);
+  if (!entry) return 0;
+
+  age = g_get_real_time() / G_USEC_PER_SEC - entry->last_used;
+
+  if (age < 4 * 24 * 3600)
+    weight = 100;
+  else if (age < 14 * 24 * 3600)
+    weight = 70;
+  else if (age < 31 * 24 * 3600)
+    weight = 50;
+  else if (age < 90 * 24 * 3600)
+    weight = 30;
+  else
+    weight = 10;
+
+  return (int)MIN(entry->count, 1000) * weight;
+}
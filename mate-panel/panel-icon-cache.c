@@ -0,0 +1,136 @@
+/*
+ * panel-icon-cache.c: shared cache of the icon surfaces of panel buttons
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "panel-icon-cache.h"
+
+#include "panel-util.h"
+
+/* Many buttons show the same icon at the same size: the surfaces loaded by
+ * panel_load_icon () are shared between them, keyed by everything that
+ * goes into the loading. The least recently used entries are dropped once
+ * there are too many, and all the entries of an icon theme are dropped
+ * when it changes. Failures are cached too, so that a missing icon is not
+ * looked up again by every button using it. */
+
+#define PANEL_ICON_CACHE_MAX_ENTRIES 128
+#define PANEL_ICON_CACHE_THEME_DATA "panel-icon-cache-connected"
+
+typedef struct {
+  GList link;
+
+  char *key;
+  GtkIconTheme *icon_theme;
+  cairo_surface_t *surface;
+  char *error_msg;
+} PanelIconCacheEntry;
+
+static GHashTable *icon_cache = NULL;
+/* most recently used first */
+static GQueue icon_cache_lru = G_QUEUE_INIT;
+
+static void panel_icon_cache_entry_free(PanelIconCacheEntry *entry) {
+  g_queue_unlink(&icon_cache_lru, &entry->link);
+
+  g_free(entry->key);
+  if (entry->surface) cairo_surface_destroy(entry->surface);
+  g_free(entry->error_msg);
+
+  g_slice_free(PanelIconCacheEntry, entry);
+}
+
+static gboolean panel_icon_cache_entry_has_theme(gpointer key, gpointer value,
+                                                 gpointer user_data) {
+  PanelIconCacheEntry *entry = value;
+
+  return entry->icon_theme == user_data;
+}
+
+/* Connected before the buttons get the signal (they connect after), so
+ * that they reload from a clean cache */
+static void panel_icon_cache_theme_changed(GtkIconTheme *icon_theme) {
+  g_hash_table_foreach_remove(icon_cache, panel_icon_cache_entry_has_theme,
+                              icon_theme);
+}
+
+static void panel_icon_cache_watch_theme(GtkIconTheme *icon_theme) {
+  if (g_object_get_data(G_OBJECT(icon_theme), PANEL_ICON_CACHE_THEME_DATA))
+    return;
+
+  g_signal_connect(icon_theme, "changed",
+                   G_CALLBACK(panel_icon_cache_theme_changed), NULL);
+  g_object_set_data(G_OBJECT(icon_theme), PANEL_ICON_CACHE_THEME_DATA,
+                    GINT_TO_POINTER(TRUE));
+}
+
+/* Returns a new reference to the surface, as panel_load_icon () does */
+cairo_surface_t *panel_icon_cache_load(GtkIconTheme *icon_theme,
+                                       const char *icon_name, int size,
+                                       int desired_width, int desired_height,
+                                       char **error_msg) {
+  PanelIconCacheEntry *entry;
+  char *key;
+
+  g_return_val_if_fail(GTK_IS_ICON_THEME(icon_theme), NULL);
+  g_return_val_if_fail(icon_name != NULL, NULL);
+  g_return_val_if_fail(error_msg == NULL || *error_msg == NULL, NULL);
+
+  if (!icon_cache)
+    icon_cache =
+        g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                              (GDestroyNotify)panel_icon_cache_entry_free);
+
+  key = g_strdup_printf("%p:%d:%d:%d:%s", (gpointer)icon_theme, size,
+                        desired_width, desired_height, icon_name);
+
+  entry = g_hash_table_lookup(icon_cache, key);
+  if (entry) {
+    g_free(key);
+    g_queue_unlink(&icon_cache_lru, &entry->link);
+  } else {
+    entry = g_slice_new0(PanelIconCacheEntry);
+    entry->link.data = entry;
+    entry->key = key;
+    entry->icon_theme = icon_theme;
+    entry->surface =
+        panel_load_icon(icon_theme, icon_name, size, desired_width,
+                        desired_height, &entry->error_msg);
+
+    panel_icon_cache_watch_theme(icon_theme);
+    g_hash_table_insert(icon_cache, entry->key, entry);
+
+    while (g_queue_get_length(&icon_cache_lru) >=
+           PANEL_ICON_CACHE_MAX_ENTRIES) {
+      PanelIconCacheEntry *last = g_queue_peek_tail(&icon_cache_lru);
+
+      g_hash_table_remove(icon_cache, last->key);
+    }
+  }
+
+  g_queue_push_head_link(&icon_cache_lru, &entry->link);
+
+  if (error_msg && entry->error_msg) *error_msg = g_strdup(entry->error_msg);
+
+  return entry->surface ? cairo_surface_reference(entry->surface) : NULL;
+}
@@ -0,0 +1,36 @@
+/*
+ * panel-icon-cache.h: shared cache of the icon surfaces of panel buttons
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_ICON_CACHE_H__
+#define __PANEL_ICON_CACHE_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+cairo_surface_t *panel_icon_cache_load(GtkIconTheme *icon_theme,
+                                       const char *icon_name, int size,
+                                       int desired_width, int desired_height,
+                                       char **error_msg);
+
+G_END_DECLS
+
+#endif /* __PANEL_ICON_CACHE_H__ */
@@ -83,6 +83,7 @@ struct _PanelMenuButtonPrivate {
   char *applet_id;
 
   GtkWidget *menu;
+  guint prewarm_id;
 
   char *menu_path;
   char *custom_icon;
@@ -101,6 +102,7 @@ G_DEFINE_TYPE_WITH_PRIVATE(PanelMenuButton, panel_menu_button,
 static void panel_menu_button_disconnect_from_gsettings(
     PanelMenuButton *button);
 static void panel_menu_button_recreate_menu(PanelMenuButton *button);
+static void panel_menu_button_schedule_prewarm(PanelMenuButton *button);
 static void panel_menu_button_set_icon(PanelMenuButton *button);
 
 static AtkObject *panel_menu_button_get_accessible(GtkWidget *widget);
@@ -196,6 +198,9 @@ static void panel_menu_button_finalize(GObject *object) {
 
   panel_menu_button_disconnect_from_gsettings(button);
 
+  if (button->priv->prewarm_id) g_source_remove(button->priv->prewarm_id);
+  button->priv->prewarm_id = 0;
+
   if (button->priv->menu) {
     /* detaching the menu will kill our reference */
     gtk_menu_detach(GTK_MENU(button->priv->menu));
@@ -310,6 +315,7 @@ static void panel_menu_button_parent_set(GtkWidget *widget,
 
   panel_menu_button_associate_panel(button);
   panel_menu_button_set_icon(button);
+  panel_menu_button_schedule_prewarm(button);
 
   if (GTK_WIDGET_CLASS(panel_menu_button_parent_class)->parent_set)
     GTK_WIDGET_CLASS(panel_menu_button_parent_class)
@@ -387,9 +393,31 @@ static GtkWidget *panel_menu_button_create_menu(PanelMenuButton *button) {
   return button->priv->menu;
 }
 
+static gboolean panel_menu_button_prewarm(PanelMenuButton *button) {
+  button->priv->prewarm_id = 0;
+
+  panel_menu_button_create_menu(button);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Builds the menu when idle, rather than on the first click: its submenus
+ * then get populated in idle time too (see create_fake_menu ()) */
+static void panel_menu_button_schedule_prewarm(PanelMenuButton *button) {
+  if (button->priv->menu || button->priv->prewarm_id ||
+      !button->priv->toplevel)
+    return;
+
+  button->priv->prewarm_id =
+      g_idle_add_full(G_PRIORITY_LOW, (GSourceFunc)panel_menu_button_prewarm,
+                      button, NULL);
+}
+
 static void panel_menu_button_recreate_menu(PanelMenuButton *button) {
   if (button->priv->menu) gtk_widget_destroy(button->priv->menu);
   button->priv->menu = NULL;
+
+  panel_menu_button_schedule_prewarm(button);
 }
 
 void panel_menu_button_popup_menu(PanelMenuButton *button, guint n_button,
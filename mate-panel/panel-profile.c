@@ -42,6 +42,7 @@
 #include <libmate-desktop/mate-dconf.h>
 #include <libmate-desktop/mate-gsettings.h>
 #include <libpanel-util/panel-list.h>
+#include <libpanel-util/panel-trace.h>
 
 #include "applet.h"
 #include "panel-lockdown.h"
@@ -1000,8 +1001,11 @@ static void panel_profile_load_and_show_toplevel(char *toplevel_id) {
 static void panel_profile_load_and_show_toplevel_startup(
     const char *toplevel_id) {
   PanelToplevel *toplevel;
+
+  panel_trace_begin("load-toplevel", toplevel_id);
   toplevel = panel_profile_load_toplevel(toplevel_id);
   if (toplevel) gtk_widget_show(GTK_WIDGET(toplevel));
+  panel_trace_end("load-toplevel");
 }
 
 static void panel_profile_destroy_toplevel(const char *id) {
@@ -1399,13 +1403,18 @@ void panel_profile_settings_load(void) {
 void panel_profile_load(void) {
   panel_profile_settings_load();
 
+  panel_trace_begin("load-toplevels", NULL);
   panel_profile_load_list(
       profile_settings, PANEL_GSETTINGS_TOPLEVELS,
       (PanelProfileLoadFunc)panel_profile_load_and_show_toplevel_startup,
       G_CALLBACK(panel_profile_toplevel_id_list_notify));
+  panel_trace_end("load-toplevels");
+
+  panel_trace_begin("queue-objects", NULL);
   panel_profile_load_list(profile_settings, PANEL_GSETTINGS_OBJECTS,
                           (PanelProfileLoadFunc)panel_profile_load_object,
                           G_CALLBACK(panel_profile_object_id_list_notify));
+  panel_trace_end("queue-objects");
 
   panel_profile_ensure_toplevel_per_screen();
 
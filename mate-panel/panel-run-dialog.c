@@ -53,7 +53,10 @@
 #include <libpanel-util/panel-show.h>
 
 #include "menu.h"
+#include "panel-completion-model.h"
 #include "panel-enums.h"
+#include "panel-executables.h"
+#include "panel-frecency.h"
 #include "panel-globals.h"
 #include "panel-icon-names.h"
 #include "panel-lockdown.h"
@@ -67,6 +70,30 @@
 #include "xstuff.h"
 #endif
 
+/* Search data for the program list, one entry per row of the list store.
+ * The strings matched against what the user types are case-folded once
+ * when the list is filled, so filtering is a plain scan over flat arrays
+ * that only touches the list store for rows whose visibility or rank
+ * changes. */
+typedef struct {
+  GArray *iters;
+  GPtrArray *execs;
+  GPtrArray *exec_basenames;
+  GPtrArray *folded_execs;
+  GPtrArray *folded_exec_basenames;
+  GPtrArray *folded_names;
+  GPtrArray *folded_comments;
+  GArray *has_icon;
+  GArray *frecency;
+  GArray *visible;
+  GArray *ranks;
+} PanelRunDialogIndex;
+
+/* number of best matches moved to the top of the program list */
+#define PANEL_RUN_TOP_MATCHES 10
+/* number of rows added to the program list per idle callback */
+#define PANEL_RUN_ADD_BATCH_SIZE 100
+
 typedef struct {
   GtkWidget *run_dialog;
 
@@ -85,14 +112,18 @@ typedef struct {
   long changed_id;
 
   GtkListStore *program_list_store;
+  PanelRunDialogIndex *program_index;
 
   GHashTable *dir_hash;
-  GList *possible_executables;
-  GList *completion_items;
+  PanelCompletionModel *completion_model;
   GtkEntryCompletion *completion;
 
   int add_items_idle_id;
+  GCancellable *cancellable;
+  GPtrArray *pending_apps;
+  guint next_app;
   int find_command_idle_id;
+  int completion_prefix_idle_id;
   gboolean use_program_list;
   gboolean completion_started;
 
@@ -110,11 +141,193 @@ enum {
   COLUMN_PATH,
   COLUMN_EXEC,
   COLUMN_VISIBLE,
+  COLUMN_RANK,
   NUM_COLUMNS
 };
 
 static PanelRunDialog *static_dialog = NULL;
 
+static PanelRunDialogIndex *panel_run_dialog_index_new(void) {
+  PanelRunDialogIndex *index;
+
+  index = g_new0(PanelRunDialogIndex, 1);
+  index->iters = g_array_new(FALSE, FALSE, sizeof(GtkTreeIter));
+  index->execs = g_ptr_array_new_with_free_func(g_free);
+  index->exec_basenames = g_ptr_array_new_with_free_func(g_free);
+  index->folded_execs = g_ptr_array_new_with_free_func(g_free);
+  index->folded_exec_basenames = g_ptr_array_new_with_free_func(g_free);
+  index->folded_names = g_ptr_array_new_with_free_func(g_free);
+  index->folded_comments = g_ptr_array_new_with_free_func(g_free);
+  index->has_icon = g_array_new(FALSE, FALSE, sizeof(gboolean));
+  index->frecency = g_array_new(FALSE, FALSE, sizeof(int));
+  index->visible = g_array_new(FALSE, FALSE, sizeof(gboolean));
+  index->ranks = g_array_new(FALSE, FALSE, sizeof(int));
+
+  return index;
+}
+
+static void panel_run_dialog_index_free(PanelRunDialogIndex *index) {
+  g_array_free(index->iters, TRUE);
+  g_ptr_array_free(index->execs, TRUE);
+  g_ptr_array_free(index->exec_basenames, TRUE);
+  g_ptr_array_free(index->folded_execs, TRUE);
+  g_ptr_array_free(index->folded_exec_basenames, TRUE);
+  g_ptr_array_free(index->folded_names, TRUE);
+  g_ptr_array_free(index->folded_comments, TRUE);
+  g_array_free(index->has_icon, TRUE);
+  g_array_free(index->frecency, TRUE);
+  g_array_free(index->visible, TRUE);
+  g_array_free(index->ranks, TRUE);
+  g_free(index);
+}
+
+/* basename of the first word of a command line, or NULL if there is none */
+static char *get_command_basename(const char *command) {
+  char *word;
+  char *basename;
+
+  if (!command || !command[0]) return NULL;
+
+  word = g_strndup(command, strcspn(command, " "));
+  basename = g_path_get_basename(word);
+  g_free(word);
+
+  return basename;
+}
+
+static void panel_run_dialog_index_append(PanelRunDialogIndex *index,
+                                          GtkTreeIter *iter, const char *exec,
+                                          const char *name,
+                                          const char *comment,
+                                          const char *path,
+                                          gboolean has_icon) {
+  gboolean visible = TRUE;
+  char *exec_basename;
+  int frecency;
+  int rank;
+
+  exec_basename = get_command_basename(exec);
+  /* launches are recorded both for the desktop file, when picked from the
+   * list, and for the command name, when typed */
+  frecency = panel_frecency_get_score(path) +
+             panel_frecency_get_score(exec_basename);
+  rank = index->iters->len;
+
+  g_array_append_val(index->iters, *iter);
+  g_ptr_array_add(index->execs, g_strdup(exec));
+  g_ptr_array_add(index->exec_basenames, exec_basename);
+  g_ptr_array_add(index->folded_execs, panel_g_utf8_fold(exec));
+  g_ptr_array_add(index->folded_exec_basenames,
+                  panel_g_utf8_fold(exec_basename));
+  g_ptr_array_add(index->folded_names, panel_g_utf8_fold(name));
+  g_ptr_array_add(index->folded_comments, panel_g_utf8_fold(comment));
+  g_array_append_val(index->has_icon, has_icon);
+  g_array_append_val(index->frecency, frecency);
+  g_array_append_val(index->visible, visible);
+  g_array_append_val(index->ranks, rank);
+}
+
+static void panel_run_dialog_index_set_visible(PanelRunDialog *dialog,
+                                               guint i, gboolean visible) {
+  PanelRunDialogIndex *index = dialog->program_index;
+
+  if (g_array_index(index->visible, gboolean, i) == visible) return;
+
+  g_array_index(index->visible, gboolean, i) = visible;
+  gtk_list_store_set(dialog->program_list_store,
+                     &g_array_index(index->iters, GtkTreeIter, i),
+                     COLUMN_VISIBLE, visible, -1);
+}
+
+static void panel_run_dialog_index_set_rank(PanelRunDialog *dialog, guint i,
+                                            int rank) {
+  PanelRunDialogIndex *index = dialog->program_index;
+
+  if (g_array_index(index->ranks, int, i) == rank) return;
+
+  g_array_index(index->ranks, int, i) = rank;
+  gtk_list_store_set(dialog->program_list_store,
+                     &g_array_index(index->iters, GtkTreeIter, i), COLUMN_RANK,
+                     rank, -1);
+}
+
+static inline gboolean folded_contains(GPtrArray *array, guint i,
+                                       const char *needle) {
+  const char *haystack = g_ptr_array_index(array, i);
+
+  return haystack != NULL && strstr(haystack, needle) != NULL;
+}
+
+static inline gboolean is_word_boundary(gunichar c) {
+  return c == ' ' || c == '-' || c == '_' || c == '/' || c == '.';
+}
+
+/* Scores how well needle matches haystack, both case-folded: a substring
+ * match scores best, especially at the start of haystack or of a word;
+ * otherwise the characters of needle must appear in order, with bonuses
+ * for those at the start of a word or following the previous match.
+ * Returns -1 if needle does not match at all. */
+static int fuzzy_score(const char *haystack, const char *needle) {
+  const char *h, *n, *found;
+  gunichar prev = 0;
+  gboolean adjacent = FALSE;
+  int score;
+
+  if (!haystack || !needle) return -1;
+
+  found = strstr(haystack, needle);
+  if (found) {
+    score = 10 + 4 * (int)g_utf8_strlen(needle, -1);
+
+    if (found == haystack)
+      score += 20;
+    else if (is_word_boundary(g_utf8_get_char(g_utf8_prev_char(found))))
+      score += 10;
+
+    return score;
+  }
+
+  score = 0;
+  for (h = haystack, n = needle; *h && *n; h = g_utf8_next_char(h)) {
+    gunichar c = g_utf8_get_char(h);
+
+    if (c == g_utf8_get_char(n)) {
+      score += 1;
+      if (h == haystack || is_word_boundary(prev))
+        score += 5;
+      else if (adjacent)
+        score += 3;
+
+      adjacent = TRUE;
+      n = g_utf8_next_char(n);
+    } else {
+      adjacent = FALSE;
+    }
+
+    prev = c;
+  }
+
+  return *n ? -1 : score;
+}
+
+static int panel_run_dialog_index_score(PanelRunDialogIndex *index, guint i,
+                                        const char *folded_text) {
+  int score;
+
+  score = MAX(2 * fuzzy_score(g_ptr_array_index(index->folded_names, i),
+                              folded_text),
+              fuzzy_score(g_ptr_array_index(index->folded_exec_basenames, i),
+                          folded_text));
+
+  if (score < 0 && (folded_contains(index->folded_execs, i, folded_text) ||
+                    folded_contains(index->folded_comments, i, folded_text)))
+    score = 5;
+
+  if (score < 0) return -1;
+
+  return score + MIN(g_array_index(index->frecency, int, i), 4000) / 100;
+}
+
 static void panel_run_dialog_disconnect_pixmap(PanelRunDialog *dialog);
 
 #define PANEL_RUN_SCHEMA "org.mate.panel"
@@ -208,8 +421,6 @@ static void _panel_run_save_recent_programs_list(PanelRunDialog *dialog,
 }
 
 static void panel_run_dialog_destroy(PanelRunDialog *dialog) {
-  GList *l;
-
   dialog->changed_id = 0;
 
   g_object_unref(dialog->program_list_box);
@@ -221,22 +432,26 @@ static void panel_run_dialog_destroy(PanelRunDialog *dialog) {
   if (dialog->add_items_idle_id) g_source_remove(dialog->add_items_idle_id);
   dialog->add_items_idle_id = 0;
 
+  if (dialog->cancellable) g_cancellable_cancel(dialog->cancellable);
+  g_clear_object(&dialog->cancellable);
+  g_clear_pointer(&dialog->pending_apps, g_ptr_array_unref);
+
   if (dialog->find_command_idle_id)
     g_source_remove(dialog->find_command_idle_id);
   dialog->find_command_idle_id = 0;
 
+  if (dialog->completion_prefix_idle_id)
+    g_source_remove(dialog->completion_prefix_idle_id);
+  dialog->completion_prefix_idle_id = 0;
+
   g_clear_object(&dialog->settings);
 
   if (dialog->dir_hash) g_hash_table_destroy(dialog->dir_hash);
   dialog->dir_hash = NULL;
 
-  for (l = dialog->possible_executables; l; l = l->next) g_free(l->data);
-  g_list_free(dialog->possible_executables);
-  dialog->possible_executables = NULL;
+  g_clear_pointer(&dialog->program_index, panel_run_dialog_index_free);
 
-  for (l = dialog->completion_items; l; l = l->next) g_free(l->data);
-  g_list_free(dialog->completion_items);
-  dialog->completion_items = NULL;
+  g_clear_object(&dialog->completion_model);
 
   panel_run_dialog_disconnect_pixmap(dialog);
 
@@ -455,10 +670,19 @@ static void panel_run_dialog_execute(PanelRunDialog *dialog) {
   }
 
   if (result) {
+    char *command_basename;
+
     /* only save working commands in history */
     _panel_run_save_recent_programs_list(
         dialog, GTK_COMBO_BOX(dialog->combobox), command);
 
+    /* and count the launch for ranking the program list */
+    if (dialog->use_program_list && dialog->desktop_path)
+      panel_frecency_record(dialog->desktop_path);
+    command_basename = get_command_basename(command);
+    if (command_basename) panel_frecency_record(command_basename);
+    g_free(command_basename);
+
     /* only close the dialog if we successfully showed or launched
      * something */
     gtk_widget_destroy(dialog->run_dialog);
@@ -539,122 +763,111 @@ static void panel_run_dialog_append_file(PanelRunDialog *dialog,
   g_free(utf8_file);
 }
 
-static gboolean fuzzy_command_match(const char *cmd1, const char *cmd2,
-                                    gboolean *fuzzy) {
-  char **tokens;
-  char *word1, *word2;
-
-  g_return_val_if_fail(cmd1 && cmd2, TRUE);
-
-  *fuzzy = FALSE;
-
-  if (!strcmp(cmd1, cmd2)) return TRUE;
-
-  /* find basename of exec from desktop item.
-     strip of all arguments after the initial command */
-  tokens = g_strsplit(cmd1, " ", -1);
-  if (!tokens || !tokens[0]) {
-    g_strfreev(tokens);
-    return FALSE;
-  }
-
-  word1 = g_path_get_basename(tokens[0]);
-  g_strfreev(tokens);
-
-  /* same for the user command */
-  tokens = g_strsplit(cmd2, " ", -1);
-  if (!tokens || !tokens[0]) {
-    g_free(word1);
-    g_strfreev(tokens);
-    return FALSE;
-  }
+static void panel_run_dialog_make_all_list_visible(PanelRunDialog *dialog) {
+  guint i;
 
-  word2 = g_path_get_basename(tokens[0]);
-  g_strfreev(tokens);
+  if (!dialog->program_index) return;
 
-  if (!strcmp(word1, word2)) {
-    g_free(word1);
-    g_free(word2);
-    *fuzzy = TRUE;
-    return TRUE;
+  for (i = 0; i < dialog->program_index->iters->len; i++) {
+    panel_run_dialog_index_set_visible(dialog, i, TRUE);
+    panel_run_dialog_index_set_rank(dialog, i, i);
   }
-
-  g_free(word1);
-  g_free(word2);
-
-  return FALSE;
-}
-
-static gboolean panel_run_dialog_make_all_list_visible(GtkTreeModel *model,
-                                                       GtkTreePath *path,
-                                                       GtkTreeIter *iter,
-                                                       gpointer data) {
-  gtk_list_store_set(GTK_LIST_STORE(model), iter, COLUMN_VISIBLE, TRUE, -1);
-
-  return FALSE;
 }
 
 static gboolean panel_run_dialog_find_command_idle(PanelRunDialog *dialog) {
+  PanelRunDialogIndex *index;
   GtkTreeIter iter;
-  GtkTreeModel *model;
   GtkTreePath *path;
-  char *text;
+  const char *text;
+  char *text_basename;
+  char *folded_text;
   GIcon *found_icon;
   char *found_name;
   gboolean fuzzy;
+  guint top[PANEL_RUN_TOP_MATCHES];
+  int top_scores[PANEL_RUN_TOP_MATCHES];
+  guint n_top;
+  guint i;
 
-  model = GTK_TREE_MODEL(dialog->program_list_store);
-  path = gtk_tree_path_new_first();
-
-  if (!path || !gtk_tree_model_get_iter(model, &iter, path)) {
-    if (path) gtk_tree_path_free(path);
+  index = dialog->program_index;
 
+  if (!index || index->iters->len == 0) {
     panel_run_dialog_set_icon(dialog, NULL, FALSE);
 
     dialog->find_command_idle_id = 0;
     return FALSE;
   }
 
-  text = g_strdup(panel_run_dialog_get_combo_text(dialog));
+  text = panel_run_dialog_get_combo_text(dialog);
+  text_basename = get_command_basename(text);
+  folded_text = panel_g_utf8_fold(text);
   found_icon = NULL;
   found_name = NULL;
   fuzzy = FALSE;
 
-  do {
-    char *exec = NULL;
-    GIcon *icon = NULL;
-    char *name = NULL;
-    char *comment = NULL;
+  n_top = 0;
+
+  for (i = 0; i < index->iters->len; i++) {
+    const char *exec = g_ptr_array_index(index->execs, i);
+    const char *exec_basename = g_ptr_array_index(index->exec_basenames, i);
+    gboolean matched = FALSE;
+    int score;
+    guint j;
 
-    gtk_tree_model_get(model, &iter, COLUMN_EXEC, &exec, COLUMN_GICON, &icon,
-                       COLUMN_NAME, &name, COLUMN_COMMENT, &comment, -1);
+    if (!fuzzy && exec && g_array_index(index->has_icon, gboolean, i) &&
+        (strcmp(text, exec) == 0 ||
+         (text_basename && exec_basename &&
+          (fuzzy = (strcmp(text_basename, exec_basename) == 0))))) {
+      GtkTreeIter *row = &g_array_index(index->iters, GtkTreeIter, i);
 
-    if (!fuzzy && exec && icon && fuzzy_command_match(text, exec, &fuzzy)) {
       g_clear_object(&found_icon);
       g_free(found_name);
 
-      found_icon = g_object_ref(icon);
-      found_name = g_strdup(name);
+      gtk_tree_model_get(GTK_TREE_MODEL(dialog->program_list_store), row,
+                         COLUMN_GICON, &found_icon, COLUMN_NAME, &found_name,
+                         -1);
+      matched = TRUE;
+    }
 
-      gtk_list_store_set(dialog->program_list_store, &iter, COLUMN_VISIBLE,
-                         TRUE, -1);
-    } else if (panel_g_utf8_strstrcase(exec, text) != NULL ||
-               panel_g_utf8_strstrcase(name, text) != NULL ||
-               panel_g_utf8_strstrcase(comment, text) != NULL) {
-      gtk_list_store_set(dialog->program_list_store, &iter, COLUMN_VISIBLE,
-                         TRUE, -1);
-    } else {
-      gtk_list_store_set(dialog->program_list_store, &iter, COLUMN_VISIBLE,
-                         FALSE, -1);
+    score = folded_text ? panel_run_dialog_index_score(index, i, folded_text)
+                        : -1;
+    /* the command typed runs this program: always show it */
+    if (matched && score < 0) score = 0;
+
+    panel_run_dialog_index_set_visible(dialog, i, score >= 0);
+
+    if (score < 0) continue;
+
+    /* keep the best matches, by decreasing score, in top */
+    for (j = n_top; j > 0 && top_scores[j - 1] < score; j--) {
+      if (j < PANEL_RUN_TOP_MATCHES) {
+        top[j] = top[j - 1];
+        top_scores[j] = top_scores[j - 1];
+      }
+    }
+    if (j < PANEL_RUN_TOP_MATCHES) {
+      top[j] = i;
+      top_scores[j] = score;
+      if (n_top < PANEL_RUN_TOP_MATCHES) n_top++;
     }
+  }
+
+  /* Rows are sorted by rank: the best matches come first, in order, and
+   * everything else keeps its alphabetical position. */
+  for (i = 0; i < index->iters->len; i++) {
+    guint j;
 
-    g_free(exec);
-    if (icon != NULL) g_object_unref(icon);
-    g_free(name);
-    g_free(comment);
+    if (g_array_index(index->ranks, int, i) >= 0) continue;
 
-  } while (gtk_tree_model_iter_next(model, &iter));
+    for (j = 0; j < n_top && top[j] != i; j++)
+      ;
+    if (j == n_top) panel_run_dialog_index_set_rank(dialog, i, i);
+  }
+  for (i = 0; i < n_top; i++)
+    panel_run_dialog_index_set_rank(dialog, top[i],
+                                    (int)i - PANEL_RUN_TOP_MATCHES);
 
+  path = gtk_tree_path_new_first();
   if (gtk_tree_model_get_iter(
           gtk_tree_view_get_model(GTK_TREE_VIEW(dialog->program_list)), &iter,
           path))
@@ -667,7 +880,8 @@ static gboolean panel_run_dialog_find_command_idle(PanelRunDialog *dialog) {
   /* FIXME update dialog->program_label */
 
   g_clear_object(&found_icon);
-  g_free(text);
+  g_free(text_basename);
+  g_free(folded_text);
 
   g_free(dialog->item_name);
   dialog->item_name = found_name;
@@ -676,18 +890,35 @@ static gboolean panel_run_dialog_find_command_idle(PanelRunDialog *dialog) {
   return FALSE;
 }
 
-static int compare_applications(MateMenuTreeEntry *a, MateMenuTreeEntry *b) {
-  GDesktopAppInfo *infoa, *infob;
-  const gchar *name1;
-  const gchar *name2;
-  gint compare;
+/* What the program list needs from a menu entry. libmate-menu is not
+ * thread-safe, so this is copied from the tree on the main thread, as plain
+ * strings and a serialized icon, before being handed to the worker. */
+typedef struct {
+  char *name;
+  char *comment;
+  char *exec;
+  char *path;
+  GVariant *icon;
+  char *sort_name;
+  char *collate_key;
+} PanelRunDialogApp;
+
+static void panel_run_dialog_app_free(PanelRunDialogApp *app) {
+  g_free(app->name);
+  g_free(app->comment);
+  g_free(app->exec);
+  g_free(app->path);
+  g_clear_pointer(&app->icon, g_variant_unref);
+  g_free(app->sort_name);
+  g_free(app->collate_key);
+  g_free(app);
+}
+
+static int compare_applications(gconstpointer a, gconstpointer b) {
+  const PanelRunDialogApp *app_a = *(const PanelRunDialogApp **)a;
+  const PanelRunDialogApp *app_b = *(const PanelRunDialogApp **)b;
 
-  infoa = matemenu_tree_entry_get_app_info(a);
-  infob = matemenu_tree_entry_get_app_info(b);
-  name1 = g_app_info_get_name(G_APP_INFO(infoa));
-  name2 = g_app_info_get_name(G_APP_INFO(infob));
-  compare = g_utf8_collate(name1, name2);
-  return compare;
+  return strcmp(app_a->collate_key, app_b->collate_key);
 }
 
 static GSList *get_all_applications_from_dir(MateMenuTreeDirectory *directory,
@@ -699,7 +930,7 @@ static GSList *get_all_applications_from_alias(MateMenuTreeAlias *alias,
   switch (matemenu_tree_alias_get_aliased_item_type(alias)) {
     case MATEMENU_TREE_ITEM_ENTRY:
       item = matemenu_tree_alias_get_aliased_entry(alias);
-      list = g_slist_append(list, (MateMenuTreeEntry *)item);
+      list = g_slist_prepend(list, (MateMenuTreeEntry *)item);
       break;
     case MATEMENU_TREE_ITEM_DIRECTORY:
       item = matemenu_tree_alias_get_aliased_directory(alias);
@@ -723,7 +954,7 @@ static GSList *get_all_applications_from_dir(MateMenuTreeDirectory *directory,
     switch (type) {
       case MATEMENU_TREE_ITEM_ENTRY:
         item = matemenu_tree_iter_get_entry(iter);
-        list = g_slist_append(list, (MateMenuTreeEntry *)item);
+        list = g_slist_prepend(list, (MateMenuTreeEntry *)item);
         break;
 
       case MATEMENU_TREE_ITEM_DIRECTORY:
@@ -773,66 +1004,174 @@ static GSList *get_all_applications(void) {
   matemenu_tree_item_unref(root);
   g_object_unref(tree);
 
-  retval = g_slist_sort(retval, (GCompareFunc)compare_applications);
-
   return retval;
 }
 
-static gboolean panel_run_dialog_add_items_idle(PanelRunDialog *dialog) {
-  GtkCellRenderer *renderer;
-  GtkTreeViewColumn *column;
-  GtkTreeModel *model_filter;
-  GSList *all_applications;
+/* Walks the menu tree, on the main thread, and copies out what the program
+ * list shows of each entry */
+static GPtrArray *get_all_applications_copy(void) {
+  GSList *entries;
   GSList *l;
-  GSList *next;
-  const char *prev_name;
-
-  /* create list store */
-  dialog->program_list_store =
-      gtk_list_store_new(NUM_COLUMNS, G_TYPE_ICON, G_TYPE_STRING, G_TYPE_STRING,
-                         G_TYPE_STRING, G_TYPE_STRING, G_TYPE_BOOLEAN);
+  GPtrArray *apps;
 
-  all_applications = get_all_applications();
+  entries = get_all_applications();
+  apps = g_ptr_array_new_with_free_func(
+      (GDestroyNotify)panel_run_dialog_app_free);
 
-  /* Strip duplicates */
-  prev_name = NULL;
-  for (l = all_applications; l; l = next) {
+  for (l = entries; l; l = l->next) {
     MateMenuTreeEntry *entry = l->data;
-    const char *entry_name;
-
-    next = l->next;
     GDesktopAppInfo *ginfo;
+    PanelRunDialogApp *app;
+    GIcon *icon;
+
     ginfo = matemenu_tree_entry_get_app_info(entry);
+    icon = g_app_info_get_icon(G_APP_INFO(ginfo));
+
+    app = g_new0(PanelRunDialogApp, 1);
+    app->name = g_strdup(g_app_info_get_display_name(G_APP_INFO(ginfo)));
+    app->comment = g_strdup(g_app_info_get_description(G_APP_INFO(ginfo)));
+    app->exec = g_strdup(g_app_info_get_commandline(G_APP_INFO(ginfo)));
+    app->path = g_strdup(matemenu_tree_entry_get_desktop_file_path(entry));
+    app->icon = icon ? g_icon_serialize(icon) : NULL;
+    app->sort_name = g_strdup(g_app_info_get_name(G_APP_INFO(ginfo)));
+
+    g_ptr_array_add(apps, app);
+  }
+  g_slist_free_full(entries, matemenu_tree_item_unref);
+
+  return apps;
+}
+
+/* Runs in a worker thread: takes the array of PanelRunDialogApp copied from
+ * the menu tree, and returns it sorted by collation key and deduplicated. */
+static void get_all_applications_thread(GTask *task, gpointer source_object,
+                                        gpointer task_data,
+                                        GCancellable *cancellable) {
+  GPtrArray *apps = task_data;
+  GPtrArray *unique_apps;
+  const char *prev_name;
+  guint i;
+
+  for (i = 0; i < apps->len; i++) {
+    PanelRunDialogApp *app = g_ptr_array_index(apps, i);
+
+    if (g_cancellable_is_cancelled(cancellable)) break;
 
-    entry_name = g_app_info_get_display_name(G_APP_INFO(ginfo));
-    if (prev_name && entry_name && strcmp(entry_name, prev_name) == 0) {
-      matemenu_tree_item_unref(entry);
+    app->collate_key =
+        g_utf8_collate_key(app->sort_name ? app->sort_name : "", -1);
+  }
+
+  if (g_task_return_error_if_cancelled(task)) {
+    g_ptr_array_unref(apps);
+    return;
+  }
+
+  g_ptr_array_sort(apps, compare_applications);
+
+  /* Strip duplicates */
+  unique_apps = g_ptr_array_new_full(
+      apps->len, (GDestroyNotify)panel_run_dialog_app_free);
+  prev_name = NULL;
+  for (i = 0; i < apps->len; i++) {
+    PanelRunDialogApp *app = g_ptr_array_index(apps, i);
 
-      all_applications = g_slist_delete_link(all_applications, l);
+    if (prev_name && app->name && strcmp(app->name, prev_name) == 0) {
+      panel_run_dialog_app_free(app);
     } else {
-      prev_name = entry_name;
+      g_ptr_array_add(unique_apps, app);
+      prev_name = app->name;
     }
   }
+  g_ptr_array_set_free_func(apps, NULL);
+  g_ptr_array_unref(apps);
 
-  for (l = all_applications; l; l = l->next) {
-    MateMenuTreeEntry *entry = l->data;
+  g_task_return_pointer(task, unique_apps, (GDestroyNotify)g_ptr_array_unref);
+}
+
+static gboolean panel_run_dialog_add_batch_idle(PanelRunDialog *dialog) {
+  guint i;
+
+  for (i = 0; i < PANEL_RUN_ADD_BATCH_SIZE &&
+              dialog->next_app < dialog->pending_apps->len;
+       i++, dialog->next_app++) {
+    PanelRunDialogApp *app =
+        g_ptr_array_index(dialog->pending_apps, dialog->next_app);
     GtkTreeIter iter;
-    GDesktopAppInfo *ginfo;
-    GIcon *gicon = NULL;
+    GIcon *icon;
 
-    ginfo = matemenu_tree_entry_get_app_info(entry);
-    gicon = g_app_info_get_icon(G_APP_INFO(ginfo));
+    icon = app->icon ? g_icon_deserialize(app->icon) : NULL;
 
     gtk_list_store_append(dialog->program_list_store, &iter);
-    gtk_list_store_set(
-        dialog->program_list_store, &iter, COLUMN_GICON, gicon, COLUMN_NAME,
-        g_app_info_get_display_name(G_APP_INFO(ginfo)), COLUMN_COMMENT,
-        g_app_info_get_description(G_APP_INFO(ginfo)), COLUMN_EXEC,
-        g_app_info_get_commandline(G_APP_INFO(ginfo)), COLUMN_PATH,
-        matemenu_tree_entry_get_desktop_file_path(entry), COLUMN_VISIBLE, TRUE,
-        -1);
+    gtk_list_store_set(dialog->program_list_store, &iter, COLUMN_GICON, icon,
+                       COLUMN_NAME, app->name, COLUMN_COMMENT, app->comment,
+                       COLUMN_EXEC, app->exec, COLUMN_PATH, app->path,
+                       COLUMN_VISIBLE, TRUE, COLUMN_RANK,
+                       dialog->program_index->iters->len, -1);
+
+    panel_run_dialog_index_append(dialog->program_index, &iter, app->exec,
+                                  app->name, app->comment, app->path,
+                                  icon != NULL);
+
+    g_clear_object(&icon);
   }
-  g_slist_free_full(all_applications, matemenu_tree_item_unref);
+
+  if (dialog->next_app < dialog->pending_apps->len) return G_SOURCE_CONTINUE;
+
+  g_clear_pointer(&dialog->pending_apps, g_ptr_array_unref);
+  dialog->add_items_idle_id = 0;
+
+  /* filter the rows added since the user started typing */
+  if (!dialog->use_program_list && !dialog->find_command_idle_id &&
+      panel_run_dialog_get_combo_text(dialog)[0] != '\0')
+    dialog->find_command_idle_id = g_idle_add_full(
+        G_PRIORITY_LOW, (GSourceFunc)panel_run_dialog_find_command_idle, dialog,
+        NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void get_all_applications_ready(GObject *source_object,
+                                       GAsyncResult *result,
+                                       gpointer user_data) {
+  PanelRunDialog *dialog;
+  GPtrArray *apps;
+  GError *error = NULL;
+
+  apps = g_task_propagate_pointer(G_TASK(result), &error);
+  if (!apps) {
+    /* the dialog is already gone if the task was cancelled */
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning("Cannot load the list of applications: %s", error->message);
+    g_error_free(error);
+    return;
+  }
+
+  dialog = user_data;
+  g_clear_object(&dialog->cancellable);
+
+  dialog->pending_apps = apps;
+  dialog->next_app = 0;
+  dialog->add_items_idle_id = g_idle_add_full(
+      G_PRIORITY_LOW, (GSourceFunc)panel_run_dialog_add_batch_idle, dialog,
+      NULL);
+}
+
+static gboolean panel_run_dialog_add_items_idle(PanelRunDialog *dialog) {
+  GtkCellRenderer *renderer;
+  GtkTreeViewColumn *column;
+  GtkTreeModel *model_filter;
+  GTask *task;
+
+  /* create list store */
+  dialog->program_list_store =
+      gtk_list_store_new(NUM_COLUMNS, G_TYPE_ICON, G_TYPE_STRING, G_TYPE_STRING,
+                         G_TYPE_STRING, G_TYPE_STRING, G_TYPE_BOOLEAN,
+                         G_TYPE_INT);
+  gtk_tree_sortable_set_sort_column_id(
+      GTK_TREE_SORTABLE(dialog->program_list_store), COLUMN_RANK,
+      GTK_SORT_ASCENDING);
+
+  dialog->program_index = panel_run_dialog_index_new();
 
   model_filter = gtk_tree_model_filter_new(
       GTK_TREE_MODEL(dialog->program_list_store), NULL);
@@ -858,6 +1197,17 @@ static gboolean panel_run_dialog_add_items_idle(PanelRunDialog *dialog) {
 
   gtk_tree_view_append_column(GTK_TREE_VIEW(dialog->program_list), column);
 
+  /* the menu tree is walked here, the entries are sorted in a thread, and
+   * rows are added as batches in idle time once it is done */
+  dialog->cancellable = g_cancellable_new();
+  task = g_task_new(NULL, dialog->cancellable, get_all_applications_ready,
+                    dialog);
+  g_task_set_source_tag(task, panel_run_dialog_add_items_idle);
+  /* owned by get_all_applications_thread(), which always runs */
+  g_task_set_task_data(task, get_all_applications_copy(), NULL);
+  g_task_run_in_thread(task, get_all_applications_thread);
+  g_object_unref(task);
+
   dialog->add_items_idle_id = 0;
   return G_SOURCE_REMOVE;
 }
@@ -1145,7 +1495,7 @@ static void panel_run_dialog_setup_file_button(PanelRunDialog *dialog,
 }
 
 static GList *fill_files_from(const char *dirname, const char *dirprefix,
-                              char prefix, GList *existing_items) {
+                              char prefix) {
   GList *list;
   DIR *dir;
   struct dirent *dent;
@@ -1188,96 +1538,32 @@ static GList *fill_files_from(const char *dirname, const char *dirprefix,
   return list;
 }
 
-static GList *fill_possible_executables(void) {
-  GList *list;
-  const char *path;
-  char **pathv;
-  int i;
-
-  list = NULL;
-  path = g_getenv("PATH");
-
-  if (!path || !path[0]) return list;
-
-  pathv = g_strsplit(path, ":", 0);
-
-  for (i = 0; pathv[i]; i++) {
-    const char *file;
-    GDir *dir;
-
-    dir = g_dir_open(pathv[i], 0, NULL);
-
-    if (!dir) continue;
-
-    while ((file = g_dir_read_name(dir))) {
-      list = g_list_prepend(list, g_build_filename(pathv[i], file, NULL));
-    }
-
-    g_dir_close(dir);
-  }
-
-  g_strfreev(pathv);
-
-  return list;
-}
-
-static GList *fill_executables(GList *possible_executables,
-                               GList *existing_items, char prefix) {
-  GList *list;
-  GList *l;
-
-  list = NULL;
-
-  for (l = possible_executables; l; l = l->next) {
-    const char *filename;
-    char *basename;
-
-    filename = l->data;
-    basename = g_path_get_basename(filename);
-
-    if (basename[0] == prefix &&
-        g_file_test(filename, G_FILE_TEST_IS_REGULAR) &&
-        g_file_test(filename, G_FILE_TEST_IS_EXECUTABLE)) {
-      if (g_list_find_custom(existing_items, basename, (GCompareFunc)strcmp)) {
-        g_free(basename);
-        return NULL;
-      }
-
-      list = g_list_prepend(list, basename);
-    } else {
-      g_free(basename);
-    }
-  }
-
-  return list;
-}
-
-static GtkTreeModel *create_completion_model(GList *list) {
-  GtkListStore *store;
-  GtkTreeIter iter;
-  GList *l;
-
-  store = gtk_list_store_new(1, G_TYPE_STRING);
-  for (l = list; l; l = l->next) {
-    gtk_list_store_append(store, &iter);
-    gtk_list_store_set(store, &iter, 0, l->data, -1);
-  }
+static gboolean completion_match_func(GtkEntryCompletion *completion,
+                                      const char *key, GtkTreeIter *iter,
+                                      PanelRunDialog *dialog) {
+  GtkWidget *entry;
+  const char *text;
+  char *item;
+  gboolean retval;
 
-  return GTK_TREE_MODEL(store);
-}
+  /* The model only exposes the rows matching the last prefix we computed,
+   * which lags behind the entry until the prefix idle ran: check the rows
+   * against the text itself, with the same rules as the model. */
+  entry = gtk_entry_completion_get_entry(completion);
+  text = gtk_entry_get_text(GTK_ENTRY(entry));
+  while (*text != '\0' && g_ascii_isspace(*text)) text++;
 
-static void completion_add_items(GtkEntryCompletion *completion, GList *list) {
-  GtkTreeModel *completion_model;
+  gtk_tree_model_get(GTK_TREE_MODEL(dialog->completion_model), iter, 0, &item,
+                     -1);
+  retval = item && g_ascii_strncasecmp(item, text, strlen(text)) == 0;
+  g_free(item);
 
-  completion_model = create_completion_model(list);
-  gtk_entry_completion_set_model(completion, completion_model);
-  g_object_unref(completion_model);
+  return retval;
 }
 
 static void panel_run_dialog_update_completion(PanelRunDialog *dialog,
                                                const char *text) {
   GList *list;
-  GList *executables;
   char prefix;
   char *buf;
   char *dirname;
@@ -1286,8 +1572,7 @@ static void panel_run_dialog_update_completion(PanelRunDialog *dialog,
 
   g_assert(text != NULL && *text != '\0' && !g_ascii_isspace(*text));
 
-  list = NULL;
-  executables = NULL;
+  panel_completion_model_set_prefix(dialog->completion_model, text);
 
   buf = g_path_get_basename(text);
   prefix = buf[0];
@@ -1300,13 +1585,10 @@ static void panel_run_dialog_update_completion(PanelRunDialog *dialog,
     dirprefix = g_strdup(dirname);
   } else {
     /* complete against relative path and executable name */
-    if (!strchr(text, '/')) {
-      executables = fill_executables(dialog->possible_executables,
-                                     dialog->completion_items, text[0]);
+    if (!strchr(text, '/'))
       dirprefix = g_strdup("");
-    } else {
+    else
       dirprefix = g_path_get_dirname(text);
-    }
 
     dirname = g_build_filename(g_get_home_dir(), dirprefix, NULL);
   }
@@ -1316,21 +1598,58 @@ static void panel_run_dialog_update_completion(PanelRunDialog *dialog,
   if (!g_hash_table_lookup(dialog->dir_hash, key)) {
     g_hash_table_insert(dialog->dir_hash, key, dialog);
 
-    list =
-        fill_files_from(dirname, dirprefix, prefix, dialog->completion_items);
+    list = fill_files_from(dirname, dirprefix, prefix);
+    panel_completion_model_add_items(dialog->completion_model, list);
+    g_list_free_full(list, g_free);
+
+    if (text[0] != '/' && !strchr(text, '/')) {
+      char prefix_str[2] = {prefix, '\0'};
+
+      list = panel_executables_get_with_prefix(prefix_str);
+      panel_completion_model_add_items(dialog->completion_model, list);
+      g_list_free_full(list, g_free);
+    }
   } else {
     g_free(key);
   }
 
-  list = g_list_concat(list, executables);
-
   g_free(dirname);
   g_free(dirprefix);
+}
+
+/* Follows the entry after any edit, so that deleting or replacing text
+ * widens the completion window again: entry_event() only prepares it for the
+ * keys typed at the end of the text. */
+static gboolean panel_run_dialog_completion_prefix_idle(
+    PanelRunDialog *dialog) {
+  GtkEditable *entry;
+  char *text;
+  char *start;
+  int pos, tmp;
+
+  dialog->completion_prefix_idle_id = 0;
+
+  entry = GTK_EDITABLE(gtk_bin_get_child(GTK_BIN(dialog->combobox)));
+
+  /* an inline completion is selected up to the end: only the text before
+   * it was typed */
+  if (gtk_editable_get_selection_bounds(entry, &pos, &tmp) &&
+      tmp == gtk_entry_get_text_length(GTK_ENTRY(entry)))
+    text = gtk_editable_get_chars(entry, 0, pos);
+  else
+    text = gtk_editable_get_chars(entry, 0, -1);
+
+  start = text;
+  while (*start != '\0' && g_ascii_isspace(*start)) start++;
+
+  if (*start == '\0')
+    panel_completion_model_set_prefix(dialog->completion_model, "");
+  else
+    panel_run_dialog_update_completion(dialog, start);
 
-  if (list == NULL) return;
+  g_free(text);
 
-  completion_add_items(dialog->completion, list);
-  dialog->completion_items = g_list_concat(dialog->completion_items, list);
+  return FALSE;
 }
 
 static gboolean entry_event(GtkEditable *entry, GdkEventKey *event,
@@ -1405,6 +1724,11 @@ static void combobox_changed(GtkComboBox *combobox, PanelRunDialog *dialog) {
 
   while (*start != '\0' && g_ascii_isspace(*start)) start++;
 
+  if (panel_profile_get_enable_autocompletion() &&
+      !dialog->completion_prefix_idle_id)
+    dialog->completion_prefix_idle_id = g_idle_add(
+        (GSourceFunc)panel_run_dialog_completion_prefix_idle, dialog);
+
   /* update item name to use for dnd */
   if (!dialog->use_program_list) {
     if (dialog->desktop_path) {
@@ -1439,8 +1763,7 @@ static void combobox_changed(GtkComboBox *combobox, PanelRunDialog *dialog) {
       GtkTreeIter iter;
       GtkTreePath *path;
 
-      gtk_tree_model_foreach(GTK_TREE_MODEL(dialog->program_list_store),
-                             panel_run_dialog_make_all_list_visible, NULL);
+      panel_run_dialog_make_all_list_visible(dialog);
 
       path = gtk_tree_path_new_first();
       if (gtk_tree_model_get_iter(
@@ -1524,7 +1847,7 @@ static void panel_run_dialog_setup_entry(PanelRunDialog *dialog,
   GtkWidget *entry;
 
   dialog->combobox = PANEL_GTK_BUILDER_GET(gui, "comboboxentry");
-  dialog->possible_executables = fill_possible_executables();
+  panel_executables_ensure();
   dialog->dir_hash =
       g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
@@ -1537,6 +1860,13 @@ static void panel_run_dialog_setup_entry(PanelRunDialog *dialog,
   gtk_entry_set_completion(GTK_ENTRY(entry), dialog->completion);
   gtk_entry_completion_set_text_column(dialog->completion, 0);
 
+  dialog->completion_model = panel_completion_model_new();
+  gtk_entry_completion_set_model(dialog->completion,
+                                 GTK_TREE_MODEL(dialog->completion_model));
+  gtk_entry_completion_set_match_func(
+      dialog->completion, (GtkEntryCompletionMatchFunc)completion_match_func,
+      dialog, NULL);
+
   gtk_combo_box_set_model(GTK_COMBO_BOX(dialog->combobox),
                           _panel_run_get_recent_programs_list(dialog));
   gtk_combo_box_set_entry_text_column(GTK_COMBO_BOX(dialog->combobox), 0);
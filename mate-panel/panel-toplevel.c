@@ -147,6 +147,10 @@ struct _PanelToplevelPrivate {
   int orig_orientation;
 
   /* relative to the monitor origin */
+  int animation_start_x;
+  int animation_start_y;
+  int animation_start_width;
+  int animation_start_height;
   int animation_end_x;
   int animation_end_y;
   int animation_end_width;
@@ -154,7 +158,7 @@ struct _PanelToplevelPrivate {
   gint64 animation_start_time; /* monotonic start time in microseconds */
   GTimeSpan
       animation_duration_time; /* monotonic duration time in microseconds */
-  guint animation_timeout;
+  guint animation_tick; /* frame clock tick callback */
 
   PanelWidget *panel_widget;
   PanelFrame *inner_frame;
@@ -1931,11 +1935,10 @@ static void panel_toplevel_update_hidden_position(PanelToplevel *toplevel,
  * a cubic (twice again).  I suppose it looks less
  * mathematical now :) -- _v_
  */
-static int get_delta(int src, int dest, GTimeSpan elapsed_time,
-                     GTimeSpan duration_time) {
+static double get_progress(GTimeSpan elapsed_time, GTimeSpan duration_time) {
   double x, percentage;
 
-  if (abs(dest - src) <= 1 || elapsed_time >= duration_time) return dest - src;
+  if (elapsed_time >= duration_time) return 1.0;
 
   /* The cubic is: p(x) = (-2) x^2 (x-1.5) */
   /* running p(p(x)) to make it more "pronounced",
@@ -1946,13 +1949,17 @@ static int get_delta(int src, int dest, GTimeSpan elapsed_time,
   /* run it again */
   percentage = -2 * (x * x) * (x - 1.5);
 
-  percentage = CLAMP(percentage, 0.0, 1.0);
+  return CLAMP(percentage, 0.0, 1.0);
+}
 
-  return ((dest - src) * percentage);
+static int get_delta(int src, int dest, double progress) {
+  return (dest - src) * progress;
 }
 
-static void panel_toplevel_update_animating_position(PanelToplevel *toplevel) {
+static void panel_toplevel_update_animating_position(PanelToplevel *toplevel,
+                                                     gint64 frame_time) {
   GTimeSpan animation_elapsed_time;
+  double progress;
   int deltax, deltay, deltaw = 0, deltah = 0;
   int monitor_offset_x, monitor_offset_y;
 
@@ -1960,43 +1967,50 @@ static void panel_toplevel_update_animating_position(PanelToplevel *toplevel) {
       (toplevel->priv->animation_duration_time <= 0))
     return;
 
+  /* the first frame may have been started before the animation */
   animation_elapsed_time =
-      g_get_monotonic_time() - toplevel->priv->animation_start_time;
+      MAX(frame_time - toplevel->priv->animation_start_time, 0);
+
+  /* The geometry is a function of the elapsed time alone, so the motion
+   * does not depend on how often the frame clock ticks */
+  progress = get_progress(animation_elapsed_time,
+                          toplevel->priv->animation_duration_time);
 
   monitor_offset_x = panel_multimonitor_x(toplevel->priv->monitor);
   monitor_offset_y = panel_multimonitor_y(toplevel->priv->monitor);
 
   if (toplevel->priv->animation_end_width != -1)
-    deltaw = get_delta(
-        toplevel->priv->geometry.width, toplevel->priv->animation_end_width,
-        animation_elapsed_time, toplevel->priv->animation_duration_time);
+    deltaw = get_delta(toplevel->priv->animation_start_width,
+                       toplevel->priv->animation_end_width, progress);
 
   if (toplevel->priv->animation_end_height != -1)
-    deltah = get_delta(
-        toplevel->priv->geometry.height, toplevel->priv->animation_end_height,
-        animation_elapsed_time, toplevel->priv->animation_duration_time);
+    deltah = get_delta(toplevel->priv->animation_start_height,
+                       toplevel->priv->animation_end_height, progress);
 
-  deltax = get_delta(toplevel->priv->geometry.x - monitor_offset_x,
-                     toplevel->priv->animation_end_x, animation_elapsed_time,
-                     toplevel->priv->animation_duration_time);
+  deltax = get_delta(toplevel->priv->animation_start_x,
+                     toplevel->priv->animation_end_x, progress);
 
-  deltay = get_delta(toplevel->priv->geometry.y - monitor_offset_y,
-                     toplevel->priv->animation_end_y, animation_elapsed_time,
-                     toplevel->priv->animation_duration_time);
+  deltay = get_delta(toplevel->priv->animation_start_y,
+                     toplevel->priv->animation_end_y, progress);
 
-  if (deltaw != 0 && abs(deltaw) > abs(deltax)) deltax = deltaw;
-  if (deltah != 0 && abs(deltah) > abs(deltay)) deltay = deltah;
+  if (progress < 1.0) {
+    if (deltaw != 0 && abs(deltaw) > abs(deltax)) deltax = deltaw;
+    if (deltah != 0 && abs(deltah) > abs(deltay)) deltay = deltah;
+  }
 
-  toplevel->priv->geometry.x += deltax;
-  toplevel->priv->geometry.y += deltay;
+  toplevel->priv->geometry.x =
+      monitor_offset_x + toplevel->priv->animation_start_x + deltax;
+  toplevel->priv->geometry.y =
+      monitor_offset_y + toplevel->priv->animation_start_y + deltay;
 
-  toplevel->priv->geometry.width += deltaw;
-  toplevel->priv->geometry.height += deltah;
+  if (toplevel->priv->animation_end_width != -1)
+    toplevel->priv->geometry.width =
+        toplevel->priv->animation_start_width + deltaw;
+  if (toplevel->priv->animation_end_height != -1)
+    toplevel->priv->geometry.height =
+        toplevel->priv->animation_start_height + deltah;
 
-  if (toplevel->priv->geometry.x - monitor_offset_x ==
-          toplevel->priv->animation_end_x &&
-      toplevel->priv->geometry.y - monitor_offset_y ==
-          toplevel->priv->animation_end_y) {
+  if (progress >= 1.0) {
     toplevel->priv->animating = FALSE;
     /* Note: it's important to set initial_animation_done to TRUE
      * as soon as possible (hence, here) since we don't want to
@@ -2093,10 +2107,8 @@ static void panel_toplevel_update_position(PanelToplevel *toplevel) {
 
   panel_toplevel_get_monitor_geometry(toplevel, &monitor_geom);
 
-  if (toplevel->priv->animating) {
-    panel_toplevel_update_animating_position(toplevel);
-    return;
-  }
+  /* the geometry is moved by panel_toplevel_animation_tick () */
+  if (toplevel->priv->animating) return;
 
   if (toplevel->priv->position_centered) {
     toplevel->priv->position_centered = FALSE;
@@ -2869,9 +2881,10 @@ static void panel_toplevel_disconnect_timeouts(PanelToplevel *toplevel) {
     g_source_remove(toplevel->priv->unhide_timeout);
   toplevel->priv->unhide_timeout = 0;
 
-  if (toplevel->priv->animation_timeout)
-    g_source_remove(toplevel->priv->animation_timeout);
-  toplevel->priv->animation_timeout = 0;
+  if (toplevel->priv->animation_tick)
+    gtk_widget_remove_tick_callback(GTK_WIDGET(toplevel),
+                                    toplevel->priv->animation_tick);
+  toplevel->priv->animation_tick = 0;
 }
 
 static void panel_toplevel_unrealize(GtkWidget *widget) {
@@ -3284,21 +3297,40 @@ static gboolean panel_toplevel_motion_notify_event(GtkWidget *widget,
     return FALSE;
 }
 
-static gboolean panel_toplevel_animation_timeout(PanelToplevel *toplevel) {
-  gtk_widget_queue_resize(GTK_WIDGET(toplevel));
+/* Each frame only moves (or resizes) the window: the size request and
+ * allocation of the panel and its applets, and the struts, are done once
+ * when the animation ends. */
+static gboolean panel_toplevel_animation_tick(GtkWidget *widget,
+                                              GdkFrameClock *frame_clock,
+                                              gpointer user_data) {
+  PanelToplevel *toplevel = PANEL_TOPLEVEL(widget);
 
-  if (!toplevel->priv->animating) {
-    toplevel->priv->animation_end_x = 0xdead;
-    toplevel->priv->animation_end_y = 0xdead;
-    toplevel->priv->animation_end_width = 0xdead;
-    toplevel->priv->animation_end_height = 0xdead;
-    toplevel->priv->animation_start_time = 0xdead;
-    toplevel->priv->animation_duration_time = 0xdead;
-    toplevel->priv->animation_timeout = 0;
-    toplevel->priv->initial_animation_done = TRUE;
+  if (toplevel->priv->animating) {
+    GdkRectangle old_geometry = toplevel->priv->geometry;
+
+    panel_toplevel_update_animating_position(
+        toplevel, gdk_frame_clock_get_frame_time(frame_clock));
+
+    panel_toplevel_move_resize_window(
+        toplevel,
+        old_geometry.x != toplevel->priv->geometry.x ||
+            old_geometry.y != toplevel->priv->geometry.y,
+        old_geometry.width != toplevel->priv->geometry.width ||
+            old_geometry.height != toplevel->priv->geometry.height);
   }
 
-  return toplevel->priv->animating;
+  if (toplevel->priv->animating) return G_SOURCE_CONTINUE;
+
+  toplevel->priv->animation_end_x = 0xdead;
+  toplevel->priv->animation_end_y = 0xdead;
+  toplevel->priv->animation_end_width = 0xdead;
+  toplevel->priv->animation_end_height = 0xdead;
+  toplevel->priv->animation_start_time = 0xdead;
+  toplevel->priv->animation_duration_time = 0xdead;
+  toplevel->priv->animation_tick = 0;
+  toplevel->priv->initial_animation_done = TRUE;
+
+  return G_SOURCE_REMOVE;
 }
 
 static GTimeSpan panel_toplevel_get_animation_time(PanelToplevel *toplevel) {
@@ -3430,13 +3462,23 @@ static void panel_toplevel_start_animation(PanelToplevel *toplevel) {
     gtk_window_present(GTK_WINDOW(toplevel->priv->attach_toplevel));
   }
 
+  /* a reversed animation starts from wherever the previous one was */
+  toplevel->priv->animation_start_x =
+      toplevel->priv->geometry.x -
+      panel_multimonitor_x(toplevel->priv->monitor);
+  toplevel->priv->animation_start_y =
+      toplevel->priv->geometry.y -
+      panel_multimonitor_y(toplevel->priv->monitor);
+  toplevel->priv->animation_start_width = toplevel->priv->geometry.width;
+  toplevel->priv->animation_start_height = toplevel->priv->geometry.height;
+
   toplevel->priv->animation_start_time = g_get_monotonic_time();
   toplevel->priv->animation_duration_time =
       panel_toplevel_get_animation_time(toplevel);
 
-  if (!toplevel->priv->animation_timeout)
-    toplevel->priv->animation_timeout = g_timeout_add(
-        20, (GSourceFunc)panel_toplevel_animation_timeout, toplevel);
+  if (!toplevel->priv->animation_tick)
+    toplevel->priv->animation_tick = gtk_widget_add_tick_callback(
+        GTK_WIDGET(toplevel), panel_toplevel_animation_tick, NULL, NULL);
 }
 
 void panel_toplevel_hide(PanelToplevel *toplevel, gboolean auto_hide,
@@ -4292,7 +4334,7 @@ static void panel_toplevel_init(PanelToplevel *toplevel) {
   toplevel->priv->animation_end_height = 0;
   toplevel->priv->animation_start_time = 0;
   toplevel->priv->animation_duration_time = 0;
-  toplevel->priv->animation_timeout = 0;
+  toplevel->priv->animation_tick = 0;
 
   toplevel->priv->panel_widget = NULL;
   toplevel->priv->inner_frame = NULL;
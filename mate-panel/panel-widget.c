@@ -1229,7 +1229,6 @@ static void panel_widget_size_allocate(GtkWidget *widget,
     for (list = panel->applet_list; list; list = list->next) {
       AppletData *ad = list->data;
       GtkRequisition chreq;
-      const char *id;
       AppletInfo *info;
       int position = ad->pos;
       PanelObjectEdgeRelativity edge_relativity = PANEL_EDGE_START;
@@ -1249,15 +1248,11 @@ static void panel_widget_size_allocate(GtkWidget *widget,
         ad->min_cells = ad->size_hints[ad->size_hints_len - 1];
       }
 
-      id = mate_panel_applet_get_id_by_widget(ad->applet);
-      if (id) {
-        info = mate_panel_applet_get_by_id(id);
-        position =
-            g_settings_get_int(info->settings, PANEL_OBJECT_POSITION_KEY);
-        edge_relativity = g_settings_get_enum(
-            info->settings, PANEL_OBJECT_RELATIVE_TO_EDGE_KEY);
-        right_stuck = g_settings_get_boolean(
-            info->settings, PANEL_OBJECT_PANEL_RIGHT_STICK_KEY);
+      info = mate_panel_applet_get_by_widget(ad->applet);
+      if (info) {
+        position = info->position;
+        edge_relativity = info->edge_relativity;
+        right_stuck = info->right_stuck;
       }
 
       /*
@@ -2589,7 +2584,19 @@ void panel_widget_set_applet_size_hints(PanelWidget *panel, GtkWidget *applet,
   AppletData *ad;
 
   ad = g_object_get_data(G_OBJECT(applet), MATE_PANEL_APPLET_DATA);
-  if (!ad) return;
+  if (!ad) {
+    g_free(size_hints);
+    return;
+  }
+
+  /* applets often send the hints they already had, e.g. after each
+   * reconfiguration of the panel: that needs no relayout */
+  if (size_hints_len > 0 && size_hints_len % 2 == 0 && ad->size_hints &&
+      ad->size_hints_len == size_hints_len &&
+      memcmp(ad->size_hints, size_hints, size_hints_len * sizeof(int)) == 0) {
+    g_free(size_hints);
+    return;
+  }
 
   g_free(ad->size_hints);
 
@@ -42,28 +42,33 @@ static gboolean xstuff_display_is_dead = FALSE;
 /* the delay per draw */
 #define MINIATURIZE_ANIMATION_DELAY_Z 10
 
-/* zoom factor, steps and delay if composited (factor must be odd) */
+/* zoom factor and duration in milliseconds if composited (factor must be
+ * odd) */
 #define ZOOM_FACTOR 5
-#define ZOOM_STEPS 14
-#define ZOOM_DELAY 10
+#define ZOOM_DURATION 240
 
 gboolean is_using_x11() {
   return GDK_IS_X11_DISPLAY(gdk_display_get_default());
 }
 
 typedef struct {
-  int size;
+  double size;
   int size_start;
   int size_end;
   PanelOrientation orientation;
   double opacity;
-  GdkPixbuf *pixbuf;
-  guint timeout_id;
+  /* the icon, scaled by the cairo matrix when drawn */
+  cairo_surface_t *surface;
+  double surface_width;
+  double surface_height;
+  gint64 start_time;
 } CompositedZoomData;
 
-static gboolean zoom_timeout(GtkWidget *window) {
-  gtk_widget_queue_draw(window);
-  return TRUE;
+static void composited_zoom_data_free(gpointer data, GClosure *closure) {
+  CompositedZoomData *zoom = data;
+
+  cairo_surface_destroy(zoom->surface);
+  g_slice_free(CompositedZoomData, zoom);
 }
 
 static gboolean idle_destroy(gpointer data) {
@@ -72,90 +77,106 @@ static gboolean idle_destroy(gpointer data) {
   return FALSE;
 }
 
-static gboolean zoom_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data) {
+static gboolean zoom_tick(GtkWidget *widget, GdkFrameClock *frame_clock,
+                          gpointer user_data) {
   CompositedZoomData *zoom;
+  gint64 frame_time;
+  double progress;
 
   zoom = user_data;
+  frame_time = gdk_frame_clock_get_frame_time(frame_clock);
 
-  if (zoom->size >= zoom->size_end) {
-    if (zoom->timeout_id) g_source_remove(zoom->timeout_id);
-    zoom->timeout_id = 0;
+  if (zoom->start_time == 0) zoom->start_time = frame_time;
 
+  progress = (double)(frame_time - zoom->start_time) /
+             (ZOOM_DURATION * G_TIME_SPAN_MILLISECOND);
+
+  if (progress >= 1.0) {
     gtk_widget_hide(widget);
     g_idle_add(idle_destroy, widget);
 
-    g_object_unref(zoom->pixbuf);
-    zoom->pixbuf = NULL;
+    return G_SOURCE_REMOVE;
+  }
 
-    g_slice_free(CompositedZoomData, zoom);
-  } else {
-    GdkPixbuf *scaled;
-    int width, height;
-    int x = 0, y = 0;
-
-    gtk_window_get_size(GTK_WINDOW(widget), &width, &height);
-
-    zoom->size += MAX((zoom->size_end - zoom->size_start) / ZOOM_STEPS, 1);
-    zoom->opacity -= 1.0 / ((double)ZOOM_STEPS + 1);
-
-    scaled = gdk_pixbuf_scale_simple(zoom->pixbuf, zoom->size, zoom->size,
-                                     GDK_INTERP_BILINEAR);
-
-    switch (zoom->orientation) {
-      case PANEL_ORIENTATION_TOP:
-        x = (width - gdk_pixbuf_get_width(scaled)) / 2;
-        y = 0;
-        break;
-
-      case PANEL_ORIENTATION_RIGHT:
-        x = width - gdk_pixbuf_get_width(scaled);
-        y = (height - gdk_pixbuf_get_height(scaled)) / 2;
-        break;
-
-      case PANEL_ORIENTATION_BOTTOM:
-        x = (width - gdk_pixbuf_get_width(scaled)) / 2;
-        y = height - gdk_pixbuf_get_height(scaled);
-        break;
-
-      case PANEL_ORIENTATION_LEFT:
-        x = 0;
-        y = (height - gdk_pixbuf_get_height(scaled)) / 2;
-        break;
-    }
+  zoom->size =
+      zoom->size_start + (zoom->size_end - zoom->size_start) * progress;
+  zoom->opacity = 1.0 - progress;
+
+  gtk_widget_queue_draw(widget);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean zoom_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data) {
+  CompositedZoomData *zoom;
+  int width, height;
+  double x = 0, y = 0;
+
+  zoom = user_data;
 
-    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-    cairo_set_source_rgba(cr, 0, 0, 0, 0.0);
-    cairo_rectangle(cr, 0, 0, width, height);
-    cairo_fill(cr);
+  gtk_window_get_size(GTK_WINDOW(widget), &width, &height);
 
-    gdk_cairo_set_source_pixbuf(cr, scaled, x, y);
-    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
-    cairo_paint_with_alpha(cr, MAX(zoom->opacity, 0));
+  switch (zoom->orientation) {
+    case PANEL_ORIENTATION_TOP:
+      x = (width - zoom->size) / 2;
+      y = 0;
+      break;
+
+    case PANEL_ORIENTATION_RIGHT:
+      x = width - zoom->size;
+      y = (height - zoom->size) / 2;
+      break;
+
+    case PANEL_ORIENTATION_BOTTOM:
+      x = (width - zoom->size) / 2;
+      y = height - zoom->size;
+      break;
 
-    g_object_unref(scaled);
+    case PANEL_ORIENTATION_LEFT:
+      x = 0;
+      y = (height - zoom->size) / 2;
+      break;
   }
 
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_rgba(cr, 0, 0, 0, 0.0);
+  cairo_rectangle(cr, 0, 0, width, height);
+  cairo_fill(cr);
+
+  cairo_translate(cr, x, y);
+  cairo_scale(cr, zoom->size / zoom->surface_width,
+              zoom->size / zoom->surface_height);
+  cairo_set_source_surface(cr, zoom->surface, 0, 0);
+  cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+  cairo_paint_with_alpha(cr, MAX(zoom->opacity, 0));
+
   return FALSE;
 }
 
 static void draw_zoom_animation_composited(GdkScreen *gscreen, int x, int y,
-                                           int w, int h, GdkPixbuf *pixbuf,
+                                           int w, int h,
+                                           cairo_surface_t *surface,
                                            PanelOrientation orientation) {
   GtkWidget *win;
   CompositedZoomData *zoom;
+  double scale_x, scale_y;
   int wx = 0, wy = 0;
 
   w += 2;
   h += 2;
 
+  cairo_surface_get_device_scale(surface, &scale_x, &scale_y);
+
   zoom = g_slice_new(CompositedZoomData);
   zoom->size = w;
   zoom->size_start = w;
   zoom->size_end = w * ZOOM_FACTOR;
   zoom->orientation = orientation;
   zoom->opacity = 1.0;
-  zoom->pixbuf = g_object_ref(pixbuf);
-  zoom->timeout_id = 0;
+  zoom->surface = cairo_surface_reference(surface);
+  zoom->surface_width = cairo_image_surface_get_width(surface) / scale_x;
+  zoom->surface_height = cairo_image_surface_get_height(surface) / scale_y;
+  zoom->start_time = 0;
 
   win = gtk_window_new(GTK_WINDOW_POPUP);
 
@@ -193,14 +214,16 @@ static void draw_zoom_animation_composited(GdkScreen *gscreen, int x, int y,
 
   gtk_window_move(GTK_WINDOW(win), wx, wy);
 
-  g_signal_connect(win, "draw", G_CALLBACK(zoom_draw), zoom);
+  /* the data goes away with the window */
+  g_signal_connect_data(win, "draw", G_CALLBACK(zoom_draw), zoom,
+                        composited_zoom_data_free, 0);
 
   /* see doc for gtk_widget_set_app_paintable() */
   gtk_widget_realize(win);
   gdk_window_set_background_pattern(gtk_widget_get_window(win), NULL);
   gtk_widget_show(win);
 
-  zoom->timeout_id = g_timeout_add(ZOOM_DELAY, (GSourceFunc)zoom_timeout, win);
+  gtk_widget_add_tick_callback(win, zoom_tick, zoom, NULL);
 }
 
 static void draw_zoom_animation(GdkScreen *gscreen, int x, int y, int w, int h,
@@ -336,12 +359,8 @@ void xstuff_zoom_animate(GtkWidget *widget, cairo_surface_t *surface,
   gscreen = gtk_widget_get_screen(widget);
 
   if (gdk_screen_is_composited(gscreen) && surface) {
-    GdkPixbuf *pixbuf = gdk_pixbuf_get_from_surface(
-        surface, 0, 0, cairo_image_surface_get_width(surface),
-        cairo_image_surface_get_height(surface));
     draw_zoom_animation_composited(gscreen, rect.x, rect.y, rect.width,
-                                   rect.height, pixbuf, orientation);
-    g_object_unref(pixbuf);
+                                   rect.height, surface, orientation);
   } else {
     GdkDisplay *display = gdk_screen_get_display(gscreen);
     GdkMonitor *monitor = gdk_display_get_monitor_at_window(